@@ -0,0 +1,101 @@
+#include "DataProcessor.h"
+#include "ReadPlanner.h"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <string>
+#include <vector>
+
+// Decoding of one range response with the run kernels (DataProcessor::decode)
+// against the register-by-register path (DataProcessor::decodeScalar). Real
+// responses are at most 125 words; the large frames make the per-register
+// cost measurable.
+
+namespace {
+constexpr size_t REGISTER_COUNT = 10000;
+
+// Frame layouts: all registers of one type, or types cycling every register
+// so every run holds a single register
+enum Layout { Uint16, Int16, Int32, Float32, Uint64, Mixed };
+
+const char *getLayoutName(int layout) {
+  static const char *names[] = {"uint16",  "int16",  "int32",
+                                "float32", "uint64", "mixed"};
+  return names[layout];
+}
+
+struct Frame {
+  ModbusLogger::DataProcessor processor;
+  ModbusLogger::DecodePlan plan;
+  std::vector<uint16_t> words;
+};
+
+void buildFrame(int layout, size_t registerCount, Frame &frame) {
+  static const ModbusLogger::RegisterType types[] = {
+      ModbusLogger::RegisterType::Uint16, ModbusLogger::RegisterType::Int16,
+      ModbusLogger::RegisterType::Int32, ModbusLogger::RegisterType::Float32,
+      ModbusLogger::RegisterType::Uint64};
+
+  std::vector<ModbusLogger::RegisterDefinition> registers(registerCount);
+  uint32_t address = 0;
+  for (size_t i = 0; i < registerCount; ++i) {
+    ModbusLogger::RegisterDefinition &reg = registers[i];
+    reg.id = static_cast<uint16_t>(i);
+    reg.address = static_cast<uint16_t>(address);
+    reg.name = "r" + std::to_string(i);
+    reg.type = layout == Mixed ? types[i % 5] : types[layout];
+    reg.regType = ModbusLogger::ModbusRegisterType::Holding;
+    reg.scale = 0.1;
+    reg.preprocessing = false;
+    reg.enabled = true;
+    reg.period = "5s";
+    address += ModbusLogger::ReadPlanner::getWordCount(reg);
+  }
+
+  ModbusLogger::RangeDefinition range;
+  range.start = 0;
+  range.count = static_cast<uint16_t>(address);
+  range.period = "5s";
+  range.regType = ModbusLogger::ModbusRegisterType::Holding;
+
+  frame.processor.loadExpressions(registers);
+  frame.plan = frame.processor.compilePlan(range, registers);
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> word(0, 0xFFFF);
+  frame.words.resize(address);
+  for (auto &value : frame.words) {
+    value = static_cast<uint16_t>(word(random));
+  }
+}
+
+void BM_DecodeRuns(benchmark::State &state) {
+  Frame frame;
+  buildFrame(static_cast<int>(state.range(0)), REGISTER_COUNT, frame);
+  std::vector<double> values;
+  for (auto _ : state) {
+    frame.processor.decode(frame.plan, frame.words, values);
+    benchmark::DoNotOptimize(values.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * REGISTER_COUNT);
+  state.SetLabel(getLayoutName(static_cast<int>(state.range(0))));
+}
+
+void BM_DecodeScalar(benchmark::State &state) {
+  Frame frame;
+  buildFrame(static_cast<int>(state.range(0)), REGISTER_COUNT, frame);
+  std::vector<double> values;
+  for (auto _ : state) {
+    frame.processor.decodeScalar(frame.plan, frame.words, values);
+    benchmark::DoNotOptimize(values.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * REGISTER_COUNT);
+  state.SetLabel(getLayoutName(static_cast<int>(state.range(0))));
+}
+} // namespace
+
+BENCHMARK(BM_DecodeRuns)->DenseRange(Uint16, Mixed);
+BENCHMARK(BM_DecodeScalar)->DenseRange(Uint16, Mixed);
+
+BENCHMARK_MAIN();
@@ -2,14 +2,15 @@ DROP VIEW daily_tariff_report;
 CREATE OR REPLACE VIEW daily_tariff_report AS
 WITH stats AS (
     SELECT  
-        day::date AS day,
-        device_id,
-        register_name,
-        MAX(diff_value) FILTER (WHERE zone = 'day')   AS day_diff,
-        MAX(diff_value) FILTER (WHERE zone = 'night') AS night_diff,
-        MAX(diff_value) AS total_diff
-    FROM inverter_tariff_stats
-    GROUP BY day::date, device_id, register_name
+        t.day,
+        g.device_id,
+        g.name AS register_name,
+        SUM(t.energy) FILTER (WHERE t.zone = 'day')   AS day_diff,
+        SUM(t.energy) FILTER (WHERE t.zone = 'night') AS night_diff,
+        SUM(t.energy) AS total_diff
+    FROM modbus_tariff_totals t
+    JOIN registers g USING (register_id)
+    GROUP BY t.day, g.device_id, g.name
 )
 SELECT 
     s.day,
@@ -2,20 +2,21 @@ CREATE MATERIALIZED VIEW inverter_tariff_stats
 WITH (timescaledb.continuous) AS
 SELECT 
     time_bucket('1 day', "timestamp") AS day,
-    device_id,
-    register_name,
+    r.device_id,
+    r.name AS register_name,
     get_tariff_zone("timestamp") AS zone,
     
     (last(value, "timestamp") - first(value, "timestamp")) as diff_value,
     last(value, "timestamp") as end_value,
     MAX(value) as max_value,
     MIN(value) as min_value
-FROM modbus_data
-WHERE register_name IN (
+FROM modbus_samples s
+JOIN registers r ON r.register_id = s.register_id
+WHERE r.name IN (
     'batChargeTotal(kWh)','batDischargeTotal(kWh)', 'dailyUsed(kWh)','genTotal(kWh)',
 	'gridBuyTotal(kWh)','gridSellTotal(kWh)','pvHistory(kWh)','todayPv1(kWh)','todayPv2(kWh)','totalUsed(kWh)'
 )
-GROUP BY day, device_id, register_name, zone
+GROUP BY day, r.device_id, r.name, zone
 WITH NO DATA;
 
 --- 2. ПОЛІТИКА ОНОВЛЕННЯ
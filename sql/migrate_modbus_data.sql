@@ -0,0 +1,66 @@
+-- Fold rows of the original text-keyed modbus_data table into modbus_samples.
+--
+-- ModbusLogger writes to modbus_samples and leaves an existing modbus_data
+-- table alone (it warns at startup). Run this once, e.g. in a quiet hour, to
+-- move its rows and replace it with the modbus_data view:
+--
+--   psql -f sql/migrate_modbus_data.sql
+--   psql -f sql/inverter_1m.sql
+--   psql -f sql/inverter_1h.sql        (or inverter_1d.sql; both create inverter_day)
+--   psql -f sql/inverter_tariff_stats.sql
+--   psql -f sql/daily_tariff_report.sql
+--
+-- The continuous aggregates over the old table are dropped here, since the
+-- table cannot be dropped while they depend on it; the scripts above recreate
+-- them over modbus_samples JOIN registers (TimescaleDB 2.10 or later).
+-- A modbus_data_legacy table left by earlier versions, which renamed the
+-- table at startup, is migrated the same way.
+
+DROP MATERIALIZED VIEW IF EXISTS inverter_1m CASCADE;
+DROP MATERIALIZED VIEW IF EXISTS inverter_day CASCADE;
+DROP MATERIALIZED VIEW IF EXISTS inverter_tariff_stats CASCADE;
+
+BEGIN;
+
+DO $$
+DECLARE
+    source text;
+BEGIN
+    IF to_regclass('modbus_data_legacy') IS NOT NULL THEN
+        source := 'modbus_data_legacy';
+    ELSIF (SELECT relkind FROM pg_class
+           WHERE oid = to_regclass('modbus_data')) = 'r' THEN
+        source := 'modbus_data';
+    ELSE
+        RAISE NOTICE 'No table of the old layout to migrate';
+        RETURN;
+    END IF;
+
+    EXECUTE format(
+        'INSERT INTO registers (device_id, name) '
+        'SELECT DISTINCT l.device_id, l.register_name FROM %I l '
+        'WHERE NOT EXISTS (SELECT FROM registers r '
+        'WHERE r.device_id = l.device_id AND r.name = l.register_name)',
+        source);
+
+    EXECUTE format(
+        'INSERT INTO modbus_samples (register_id, "timestamp", value) '
+        'SELECT r.register_id, l."timestamp", l.value FROM %I l '
+        'JOIN registers r ON r.device_id = l.device_id '
+        'AND r.name = l.register_name',
+        source);
+
+    -- Also drops the view of earlier versions that read the legacy table
+    EXECUTE format('DROP TABLE %I CASCADE', source);
+END
+$$;
+
+CREATE OR REPLACE VIEW modbus_data AS
+SELECT r.device_id, s."timestamp", r.name AS register_name, s.value
+FROM modbus_samples s
+JOIN registers r ON r.register_id = s.register_id;
+
+COMMIT;
+
+ANALYZE registers;
+ANALYZE modbus_samples;
@@ -0,0 +1,543 @@
+#include "AsyncWriter.h"
+#include "SchemaManager.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr size_t MAX_BATCH_ROWS = 5000;
+constexpr auto IDLE_WAIT = std::chrono::milliseconds(1000);
+constexpr auto RECONNECT_DELAY = std::chrono::milliseconds(5000);
+constexpr auto BLOCK_RETRY_DELAY = std::chrono::milliseconds(10);
+// Rollup rows kept while the database is down; about a day of minute buckets
+// for a hundred registers
+constexpr size_t MAX_PENDING_ROLLUPS = 150000;
+// Rejected values listed one by one; the rest are only counted
+constexpr size_t MAX_LOGGED_REJECTIONS = 10;
+
+// Add rows to totals, merging those of the same register, day and zone (a
+// statement may upsert each key only once)
+void mergeTariffRows(std::vector<TariffRow> &totals,
+                     std::vector<TariffRow> &rows) {
+  for (auto &row : rows) {
+    auto it = std::find_if(
+        totals.begin(), totals.end(), [&row](const TariffRow &total) {
+          return total.deviceId == row.deviceId && total.day == row.day &&
+                 total.zone == row.zone &&
+                 total.registerName == row.registerName;
+        });
+    if (it == totals.end()) {
+      totals.push_back(std::move(row));
+    } else {
+      it->delta += row.delta;
+      it->lastValue = row.lastValue;
+      it->lastTime = row.lastTime;
+    }
+  }
+  rows.clear();
+}
+
+bool isSameReading(const SampleRow &a, const SampleRow &b) {
+  return a.deviceId == b.deviceId && a.timestamp == b.timestamp;
+}
+
+// Split point near the middle of [begin, end) that keeps the values of one
+// device and time together, as wide mode writes them as one row
+size_t getSplitPoint(const std::vector<SampleRow> &rows, size_t begin,
+                     size_t end) {
+  size_t middle = begin + (end - begin) / 2;
+  for (size_t i = middle; i < end; ++i) {
+    if (!isSameReading(rows[i - 1], rows[i])) {
+      return i;
+    }
+  }
+  for (size_t i = middle; i > begin + 1; --i) {
+    if (!isSameReading(rows[i - 2], rows[i - 1])) {
+      return i - 1;
+    }
+  }
+  return middle;
+}
+} // namespace
+
+AsyncWriter::AsyncWriter(const DatabaseConfig &databaseConfig,
+                         const WriterConfig &config)
+    : dbManager(databaseConfig), config(config),
+      spool(config.spoolDirectory), queue(config.queueCapacity),
+      stopRequested(false), enqueued(0), dropped(0), written(0),
+      failedFlushes(0), spooled(0), replayed(0), spoolPending(0),
+      rollupsWritten(0), tariffTotalsWritten(0) {}
+
+AsyncWriter::~AsyncWriter() { stop(); }
+
+void AsyncWriter::addDevice(int deviceId,
+                            const std::vector<RegisterDefinition> &registers) {
+  devices.emplace_back(deviceId, registers);
+}
+
+void AsyncWriter::setDropHandler(
+    std::function<void(const std::vector<SampleRow> &)> handler) {
+  dropHandler = std::move(handler);
+}
+
+void AsyncWriter::start() {
+  if (thread.joinable()) {
+    return;
+  }
+
+  if (!config.spoolDirectory.empty() && !spool.isOpen()) {
+    if (spool.open()) {
+      spoolPending = spool.pendingRows();
+      if (spoolPending > 0) {
+        std::cerr << "Found " << spoolPending
+                  << " spooled values from a previous run" << std::endl;
+      }
+    } else {
+      std::cerr << "Warning: Spool disabled: " << spool.getLastError()
+                << std::endl;
+    }
+  }
+
+  stopRequested = false;
+  thread = std::thread(&AsyncWriter::run, this);
+}
+
+void AsyncWriter::stop() {
+  if (!thread.joinable()) {
+    return;
+  }
+  stopRequested = true;
+  wakeCondition.notify_all();
+  thread.join();
+  dbManager.disconnect();
+  spool.close();
+}
+
+size_t AsyncWriter::submit(std::vector<SampleRow> &rows) {
+  std::lock_guard<std::mutex> lock(submitMutex);
+  size_t accepted = 0;
+  size_t kept = 0; // Dropped rows are compacted to the front
+  for (auto &row : rows) {
+    bool pushed = queue.tryPush(std::move(row));
+    while (!pushed && config.overflowPolicy == OverflowPolicy::Block &&
+           !stopRequested) {
+      std::this_thread::sleep_for(BLOCK_RETRY_DELAY);
+      pushed = queue.tryPush(std::move(row));
+    }
+
+    if (pushed) {
+      ++accepted;
+    } else {
+      // tryPush only moves from the row when it succeeds
+      if (&rows[kept] != &row) {
+        rows[kept] = std::move(row);
+      }
+      ++kept;
+    }
+  }
+
+  if (kept > 0) {
+    std::cerr << "Warning: Writer queue full, dropped " << kept << " samples"
+              << std::endl;
+    dropped += kept;
+  }
+
+  enqueued += accepted;
+  rows.resize(kept);
+  if (accepted > 0) {
+    wakeCondition.notify_one();
+  }
+  return accepted;
+}
+
+void AsyncWriter::submitRollups(std::vector<RollupRow> &rows) {
+  if (rows.empty()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(rollupMutex);
+    pendingRollups.insert(pendingRollups.end(),
+                          std::make_move_iterator(rows.begin()),
+                          std::make_move_iterator(rows.end()));
+    if (pendingRollups.size() > MAX_PENDING_ROLLUPS) {
+      size_t excess = pendingRollups.size() - MAX_PENDING_ROLLUPS;
+      std::cerr << "Warning: Rollup queue full, dropped " << excess
+                << " oldest rollup rows" << std::endl;
+      pendingRollups.erase(pendingRollups.begin(),
+                           pendingRollups.begin() + excess);
+      dropped += excess;
+    }
+  }
+  rows.clear();
+}
+
+void AsyncWriter::submitTariffTotals(std::vector<TariffRow> &rows) {
+  std::lock_guard<std::mutex> lock(tariffMutex);
+  mergeTariffRows(pendingTariffTotals, rows);
+}
+
+AsyncWriter::Stats AsyncWriter::getStats() const {
+  Stats stats;
+  stats.queueDepth = queue.size();
+  stats.queueCapacity = queue.capacity();
+  stats.enqueued = enqueued;
+  stats.dropped = dropped;
+  stats.written = written;
+  stats.failedFlushes = failedFlushes;
+  stats.spooled = spooled;
+  stats.replayed = replayed;
+  stats.spoolPending = spoolPending;
+  stats.rollupsWritten = rollupsWritten;
+  stats.tariffTotalsWritten = tariffTotalsWritten;
+  return stats;
+}
+
+void AsyncWriter::run() {
+  std::vector<SampleRow> batch;
+  batch.reserve(MAX_BATCH_ROWS);
+
+  while (true) {
+    SampleRow row;
+    while (batch.size() < MAX_BATCH_ROWS && queue.tryPop(row)) {
+      batch.push_back(std::move(row));
+    }
+
+    if (batch.empty()) {
+      if (dbManager.isConnected()) {
+        writeRollups();
+        writeTariffTotals();
+      }
+      if (stopRequested) {
+        break;
+      }
+      if (spool.hasPending() && dbManager.isConnected()) {
+        replaySpool();
+      }
+      waitFor(IDLE_WAIT, true);
+      continue;
+    }
+
+    if (!ensureConnection()) {
+      // Keep the batch in memory only if it cannot be spooled
+      spoolRows(batch);
+      if (stopRequested) {
+        break;
+      }
+      waitFor(RECONNECT_DELAY, false);
+      continue;
+    }
+
+    // Spooled samples are older, so they are written first
+    if (spool.hasPending() && !replaySpool()) {
+      continue;
+    }
+
+    FlushStats stats;
+    if (dbManager.writeSamples(batch, stats)) {
+      written += stats.rows;
+      std::cerr << "Stored " << stats.rows << " values in "
+                << stats.latency.count() / 1000.0 << " ms" << std::endl;
+      batch.clear();
+      writeRollups();
+      writeTariffTotals();
+      continue;
+    }
+
+    ++failedFlushes;
+    std::vector<SampleRow> rejected;
+    if (dbManager.isConnected() && writeAroundRejected(batch, rejected)) {
+      // Server rejected some values themselves; retrying would fail forever
+      dropRows(rejected);
+      batch.clear();
+      writeRollups();
+      writeTariffTotals();
+    } else {
+      // Connection lost; spool the rest of the batch (or keep it) and retry
+      // after reconnecting
+      dropRows(rejected);
+      spoolRows(batch);
+      if (stopRequested) {
+        break;
+      }
+      waitFor(RECONNECT_DELAY, false);
+    }
+  }
+
+  // Whatever could not be written is kept for the next run if possible
+  SampleRow row;
+  while (queue.tryPop(row)) {
+    batch.push_back(std::move(row));
+  }
+  spoolRows(batch);
+
+  if (!batch.empty()) {
+    std::cerr << "Warning: Writer stopped with " << batch.size()
+              << " values not stored" << std::endl;
+    dropRows(batch);
+  }
+
+  std::lock_guard<std::mutex> lock(rollupMutex);
+  if (!pendingRollups.empty()) {
+    std::cerr << "Warning: Writer stopped with " << pendingRollups.size()
+              << " rollup rows not stored" << std::endl;
+    dropped += pendingRollups.size();
+    pendingRollups.clear();
+  }
+
+  std::lock_guard<std::mutex> tariffLock(tariffMutex);
+  if (!pendingTariffTotals.empty()) {
+    std::cerr << "Warning: Writer stopped with " << pendingTariffTotals.size()
+              << " tariff totals not stored" << std::endl;
+    dropped += pendingTariffTotals.size();
+    pendingTariffTotals.clear();
+  }
+}
+
+bool AsyncWriter::ensureConnection() {
+  if (dbManager.isConnected()) {
+    return true;
+  }
+
+  std::cerr << "Reconnecting to database..." << std::endl;
+  if (!dbManager.connect()) {
+    std::cerr << "Error: Failed to reconnect to database: "
+              << dbManager.getLastError() << std::endl;
+    return false;
+  }
+
+  // Ensure tables exist (the database may have been down at startup)
+  SchemaManager schemaManager(dbManager);
+  bool schemaReady = devices.empty() ? schemaManager.ensureTableExists(0, {})
+                                     : true;
+  for (size_t i = 0; i < devices.size() && schemaReady; ++i) {
+    schemaReady =
+        schemaManager.ensureTableExists(devices[i].first, devices[i].second);
+  }
+  if (!schemaReady) {
+    std::cerr << "Error: Failed to ensure table exists" << std::endl;
+    dbManager.disconnect();
+    return false;
+  }
+
+  return true;
+}
+
+bool AsyncWriter::spoolRows(std::vector<SampleRow> &rows) {
+  if (rows.empty()) {
+    return true;
+  }
+  if (!spool.isOpen()) {
+    return false;
+  }
+
+  size_t stored = spool.append(rows);
+  if (stored == 0) {
+    return false;
+  }
+
+  if (stored < rows.size()) {
+    // The spool keeps a prefix of the rows
+    std::cerr << "Warning: Dropped " << rows.size() - stored
+              << " values that could not be spooled" << std::endl;
+    dropRows(std::vector<SampleRow>(rows.begin() + stored, rows.end()));
+  }
+
+  spooled += stored;
+  spoolPending = spool.pendingRows();
+  std::cerr << "Spooled " << stored << " values (" << spoolPending
+            << " pending)" << std::endl;
+  rows.clear();
+  return true;
+}
+
+void AsyncWriter::dropRows(const std::vector<SampleRow> &rows) {
+  dropped += rows.size();
+  if (dropHandler && !rows.empty()) {
+    dropHandler(rows);
+  }
+}
+
+bool AsyncWriter::writeAroundRejected(std::vector<SampleRow> &rows,
+                                      std::vector<SampleRow> &rejected) {
+  // Ranges of rows still to write, the next one at the back
+  std::vector<std::pair<size_t, size_t>> pending;
+  auto split = [&](size_t begin, size_t end) {
+    size_t middle = getSplitPoint(rows, begin, end);
+    pending.emplace_back(middle, end);
+    pending.emplace_back(begin, middle);
+  };
+  if (rows.size() > 1) {
+    split(0, rows.size());
+  } else {
+    pending.emplace_back(0, rows.size());
+  }
+
+  // Every failed half would be reported otherwise
+  dbManager.setErrorLogging(false);
+  std::vector<size_t> rejectedIndexes;
+  std::vector<SampleRow> chunk;
+  FlushStats total;
+  bool connected = true;
+  while (!pending.empty()) {
+    std::pair<size_t, size_t> range = pending.back();
+    pending.pop_back();
+    chunk.assign(rows.begin() + range.first, rows.begin() + range.second);
+
+    FlushStats stats;
+    if (dbManager.writeSamples(chunk, stats)) {
+      total.rows += stats.rows;
+      total.latency += stats.latency;
+      continue;
+    }
+    if (!dbManager.isConnected()) {
+      pending.push_back(range);
+      connected = false;
+      break;
+    }
+
+    if (range.second - range.first > 1) {
+      split(range.first, range.second);
+      continue;
+    }
+
+    const SampleRow &row = rows[range.first];
+    if (rejectedIndexes.size() < MAX_LOGGED_REJECTIONS) {
+      std::cerr << "Error: Dropping value " << row.value << " of "
+                << row.registerName << " (device " << row.deviceId << ") at "
+                << DatabaseManager::formatTimestamp(row.timestamp)
+                << " rejected by database: " << dbManager.getLastError()
+                << std::endl;
+    }
+    rejectedIndexes.push_back(range.first);
+  }
+  dbManager.setErrorLogging(true);
+
+  if (rejectedIndexes.size() > MAX_LOGGED_REJECTIONS) {
+    std::cerr << "Error: Dropping "
+              << rejectedIndexes.size() - MAX_LOGGED_REJECTIONS
+              << " more values rejected by database" << std::endl;
+  }
+  if (total.rows > 0) {
+    written += total.rows;
+    std::cerr << "Stored " << total.rows << " values in "
+              << total.latency.count() / 1000.0 << " ms" << std::endl;
+  }
+
+  // Rejected rows all come before the ranges still pending
+  for (size_t index : rejectedIndexes) {
+    rejected.push_back(std::move(rows[index]));
+  }
+  std::vector<SampleRow> unwritten;
+  for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+    std::move(rows.begin() + it->first, rows.begin() + it->second,
+              std::back_inserter(unwritten));
+  }
+  rows.swap(unwritten);
+  return connected;
+}
+
+bool AsyncWriter::replaySpool() {
+  spool.replay([this](const std::vector<SampleRow> &rows) {
+    FlushStats stats;
+    if (dbManager.copySamples(rows, stats)) {
+      replayed += stats.rows;
+      std::cerr << "Replayed " << stats.rows << " spooled values in "
+                << stats.latency.count() / 1000.0 << " ms" << std::endl;
+      return true;
+    }
+
+    ++failedFlushes;
+    std::vector<SampleRow> remaining(rows);
+    std::vector<SampleRow> rejected;
+    if (!dbManager.isConnected() ||
+        !writeAroundRejected(remaining, rejected)) {
+      return false; // Keep the segment for the next attempt
+    }
+
+    // Spooled rows carry no register id for the drop handler
+    dropped += rejected.size();
+    return true;
+  });
+
+  spoolPending = spool.pendingRows();
+  return !spool.hasPending();
+}
+
+bool AsyncWriter::writeRollups() {
+  std::vector<RollupRow> rows;
+  {
+    std::lock_guard<std::mutex> lock(rollupMutex);
+    rows.swap(pendingRollups);
+  }
+  if (rows.empty()) {
+    return true;
+  }
+
+  FlushStats stats;
+  if (dbManager.writeRollups(rows, stats)) {
+    rollupsWritten += stats.rows;
+    std::cerr << "Stored " << stats.rows << " rollup rows in "
+              << stats.latency.count() / 1000.0 << " ms" << std::endl;
+    return true;
+  }
+
+  ++failedFlushes;
+  if (dbManager.isConnected()) {
+    std::cerr << "Error: Dropping " << rows.size()
+              << " rollup rows rejected by database: "
+              << dbManager.getLastError() << std::endl;
+    dropped += rows.size();
+    return true;
+  }
+
+  // Connection lost; put them back ahead of rows submitted meanwhile
+  std::lock_guard<std::mutex> lock(rollupMutex);
+  rows.insert(rows.end(), std::make_move_iterator(pendingRollups.begin()),
+              std::make_move_iterator(pendingRollups.end()));
+  pendingRollups.swap(rows);
+  return false;
+}
+
+bool AsyncWriter::writeTariffTotals() {
+  std::vector<TariffRow> rows;
+  {
+    std::lock_guard<std::mutex> lock(tariffMutex);
+    rows.swap(pendingTariffTotals);
+  }
+  if (rows.empty()) {
+    return true;
+  }
+
+  FlushStats stats;
+  if (dbManager.writeTariffTotals(rows, stats)) {
+    tariffTotalsWritten += stats.rows;
+    return true;
+  }
+
+  ++failedFlushes;
+  if (dbManager.isConnected()) {
+    std::cerr << "Error: Dropping " << rows.size()
+              << " tariff totals rejected by database: "
+              << dbManager.getLastError() << std::endl;
+    dropped += rows.size();
+    return true;
+  }
+
+  // Connection lost; merge rows submitted meanwhile into them
+  std::lock_guard<std::mutex> lock(tariffMutex);
+  mergeTariffRows(rows, pendingTariffTotals);
+  pendingTariffTotals.swap(rows);
+  return false;
+}
+
+void AsyncWriter::waitFor(std::chrono::milliseconds timeout, bool wakeOnData) {
+  std::unique_lock<std::mutex> lock(wakeMutex);
+  wakeCondition.wait_for(lock, timeout, [this, wakeOnData]() {
+    return stopRequested.load() || (wakeOnData && !queue.empty());
+  });
+}
+
+} // namespace ModbusLogger
@@ -0,0 +1,129 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include "DatabaseManager.h"
+#include "SampleSpool.h"
+#include "SpscQueue.h"
+#include "Types.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Database writer running on its own thread. The poll loops hand over samples
+// through a bounded single-producer/single-consumer queue (producers take
+// turns under a mutex), so serial timing does not depend on database
+// latency. The writer owns its own connection
+// and reconnects on its own; while the database is unreachable samples go to
+// an on-disk spool and are replayed with COPY once it is back. Rollup rows
+// and tariff totals take separate, small in-memory queues and are upserted
+// alongside.
+class AsyncWriter {
+public:
+  struct Stats {
+    size_t queueDepth;
+    size_t queueCapacity;
+    uint64_t enqueued;
+    uint64_t dropped;
+    uint64_t written;
+    uint64_t failedFlushes;
+    uint64_t spooled;
+    uint64_t replayed;
+    uint64_t spoolPending;
+    uint64_t rollupsWritten;
+    uint64_t tariffTotalsWritten;
+  };
+
+  AsyncWriter(const DatabaseConfig &databaseConfig, const WriterConfig &config);
+  ~AsyncWriter();
+
+  AsyncWriter(const AsyncWriter &) = delete;
+  AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+  // Device whose schema is ensured on every (re)connect; call before start()
+  void addDevice(int deviceId, const std::vector<RegisterDefinition> &registers);
+
+  // Called on the writer thread with accepted rows that were then dropped
+  // instead of reaching the database or the spool (e.g. rejected by the
+  // server), so change detection can write them again; call before start()
+  void setDropHandler(std::function<void(const std::vector<SampleRow> &)> handler);
+
+  void start();
+
+  // Write what is still queued (spooling it if the database is down) and
+  // join the writer thread
+  void stop();
+
+  // Producer side, callable from any poll thread: move rows into the queue
+  // according to the overflow policy. Returns the number of rows accepted;
+  // rows is left with the rows that were dropped.
+  size_t submit(std::vector<SampleRow> &rows);
+
+  // Queue closed rollup buckets; rows is left empty
+  void submitRollups(std::vector<RollupRow> &rows);
+
+  // Queue counter increases, adding them to queued ones of the same register,
+  // day and zone; rows is left empty
+  void submitTariffTotals(std::vector<TariffRow> &rows);
+
+  Stats getStats() const;
+
+private:
+  void run();
+  bool ensureConnection();
+  // Move rows to the spool; returns false if there is no usable spool
+  bool spoolRows(std::vector<SampleRow> &rows);
+  // Count rows as dropped and report them to the drop handler
+  void dropRows(const std::vector<SampleRow> &rows);
+  // Once the server rejected rows as a whole: write them in halves, down to
+  // single rows, and move only the rows it rejects on their own to rejected.
+  // Returns false if the connection was lost; rows is then left with the
+  // rows not written yet.
+  bool writeAroundRejected(std::vector<SampleRow> &rows,
+                           std::vector<SampleRow> &rejected);
+  // Write spooled segments; returns false if some are still pending
+  bool replaySpool();
+  // Upsert the queued rollup rows; they are kept while the connection is
+  // down. Returns false if some are still pending.
+  bool writeRollups();
+  // Same for the queued tariff totals
+  bool writeTariffTotals();
+  // Sleep until timeout or stop; optionally also wake when samples arrive
+  void waitFor(std::chrono::milliseconds timeout, bool wakeOnData);
+
+  DatabaseManager dbManager;
+  WriterConfig config;
+  std::vector<std::pair<int, std::vector<RegisterDefinition>>> devices;
+  std::function<void(const std::vector<SampleRow> &)> dropHandler;
+  SampleSpool spool;
+  SpscQueue<SampleRow> queue;
+  std::mutex submitMutex; // Serializes producers on the queue
+  std::vector<RollupRow> pendingRollups;
+  std::mutex rollupMutex;
+  std::vector<TariffRow> pendingTariffTotals;
+  std::mutex tariffMutex;
+  std::thread thread;
+  std::atomic<bool> stopRequested;
+  std::mutex wakeMutex;
+  std::condition_variable wakeCondition;
+
+  std::atomic<uint64_t> enqueued;
+  std::atomic<uint64_t> dropped;
+  std::atomic<uint64_t> written;
+  std::atomic<uint64_t> failedFlushes;
+  std::atomic<uint64_t> spooled;
+  std::atomic<uint64_t> replayed;
+  std::atomic<uint64_t> spoolPending;
+  std::atomic<uint64_t> rollupsWritten;
+  std::atomic<uint64_t> tariffTotalsWritten;
+};
+
+} // namespace ModbusLogger
+
+#endif // ASYNCWRITER_H
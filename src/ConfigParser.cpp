@@ -1,5 +1,9 @@
 #include "ConfigParser.h"
+#include "Expression.h"
 #include "PeriodParser.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
@@ -9,6 +13,116 @@ using json = nlohmann::json;
 
 namespace ModbusLogger {
 
+namespace {
+double parseTolerance(const json &compressionJson, const char *key,
+                      const std::string &context) {
+  if (!compressionJson.contains(key)) {
+    return 0.0;
+  }
+  if (!compressionJson[key].is_number() ||
+      compressionJson[key].get<double>() < 0.0) {
+    throw ConfigParseException(context + " has invalid compression '" + key +
+                               "' (must be a non-negative number)");
+  }
+  return compressionJson[key];
+}
+
+// Lookup table of an expression: integer keys (as strings) to values
+std::map<int64_t, double> parseLookup(const json &lookupJson,
+                                      const std::string &context) {
+  if (!lookupJson.is_object()) {
+    throw ConfigParseException(context + " has invalid 'lookup'");
+  }
+  std::map<int64_t, double> lookup;
+  for (auto it = lookupJson.begin(); it != lookupJson.end(); ++it) {
+    size_t parsed = 0;
+    int64_t key = 0;
+    try {
+      key = std::stoll(it.key(), &parsed);
+    } catch (const std::exception &) {
+      parsed = 0;
+    }
+    if (parsed == 0 || parsed != it.key().size() || !it.value().is_number()) {
+      throw ConfigParseException(context + " has invalid lookup entry '" +
+                                 it.key() + "'");
+    }
+    lookup[key] = it.value();
+  }
+  return lookup;
+}
+
+CompressionConfig parseCompression(const json &compressionJson,
+                                   const std::string &context) {
+  if (!compressionJson.is_object() || !compressionJson.contains("method") ||
+      !compressionJson["method"].is_string()) {
+    throw ConfigParseException(context +
+                               " has invalid 'compression' (needs 'method')");
+  }
+
+  CompressionConfig compression;
+  std::string method = compressionJson["method"];
+  if (method == "none") {
+    compression.method = CompressionMethod::None;
+  } else if (method == "deadband") {
+    compression.method = CompressionMethod::Deadband;
+  } else if (method == "swinging_door") {
+    compression.method = CompressionMethod::SwingingDoor;
+  } else {
+    throw ConfigParseException(context + " has invalid compression method: " +
+                               method +
+                               " (must be none, deadband or swinging_door)");
+  }
+  compression.absolute = parseTolerance(compressionJson, "absolute", context);
+  compression.percent = parseTolerance(compressionJson, "percent", context);
+  return compression;
+}
+// Heartbeat interval: a period or "none"
+std::string parseMaxSilence(const json &silenceJson,
+                            const std::string &context) {
+  if (!silenceJson.is_string()) {
+    throw ConfigParseException(context + " has invalid 'max_silence'");
+  }
+  std::string silenceStr = silenceJson;
+  if (silenceStr != "none") {
+    try {
+      PeriodParser::parsePeriod(silenceStr);
+    } catch (const ConfigParseException &e) {
+      throw ConfigParseException(context +
+                                 " has invalid max_silence: " + e.what());
+    }
+  }
+  return silenceStr;
+}
+
+// Local time of day "HH:MM" in minutes after midnight; "24:00" ends a day
+int parseTimeOfDay(const json &timeJson, const std::string &context) {
+  int hours = -1;
+  int minutes = -1;
+  char extra = 0;
+  if (timeJson.is_string()) {
+    std::string timeStr = timeJson;
+    if (std::sscanf(timeStr.c_str(), "%2d:%2d%c", &hours, &minutes, &extra) !=
+            2 ||
+        minutes < 0 || minutes > 59 || hours < 0 ||
+        hours * 60 + minutes > 24 * 60) {
+      hours = -1;
+    }
+  }
+  if (hours < 0) {
+    throw ConfigParseException(context + " (expected time of day HH:MM)");
+  }
+  return hours * 60 + minutes;
+}
+
+bool parseCounter(const json &counterJson, const std::string &context) {
+  if (!counterJson.is_boolean()) {
+    throw ConfigParseException(context +
+                               " has invalid 'counter' (must be a boolean)");
+  }
+  return counterJson;
+}
+} // namespace
+
 Config ConfigParser::parse(const std::string &configPath) {
   std::ifstream file(configPath);
   if (!file.is_open()) {
@@ -30,7 +144,139 @@ Config ConfigParser::parse(const std::string &configPath) {
     throw ConfigParseException(
         "Missing 'database.connection_string' in config");
   }
-  config.databaseConnectionString = configJson["database"]["connection_string"];
+  const auto &databaseJson = configJson["database"];
+  config.database.connectionString = databaseJson["connection_string"];
+  if (databaseJson.contains("storage")) {
+    if (!databaseJson["storage"].is_string()) {
+      throw ConfigParseException(
+          "Invalid 'database.storage' (must be a string)");
+    }
+    config.database.storageMode = parseStorageMode(databaseJson["storage"]);
+  }
+
+  // Parse TimescaleDB settings (optional)
+  if (databaseJson.contains("timescale")) {
+    const auto &timescaleJson = databaseJson["timescale"];
+    if (!timescaleJson.is_object()) {
+      throw ConfigParseException(
+          "Invalid 'database.timescale' (must be an object)");
+    }
+    TimescaleConfig &timescale = config.database.timescale;
+    timescale.enabled = true;
+    if (timescaleJson.contains("enabled")) {
+      if (!timescaleJson["enabled"].is_boolean()) {
+        throw ConfigParseException(
+            "Invalid 'database.timescale.enabled' (must be a boolean)");
+      }
+      timescale.enabled = timescaleJson["enabled"];
+    }
+    if (timescaleJson.contains("chunk_interval")) {
+      if (!timescaleJson["chunk_interval"].is_string()) {
+        throw ConfigParseException(
+            "Invalid 'database.timescale.chunk_interval' (must be a string)");
+      }
+      timescale.chunkInterval = timescaleJson["chunk_interval"];
+    }
+    if (timescaleJson.contains("compress_after")) {
+      if (!timescaleJson["compress_after"].is_string()) {
+        throw ConfigParseException(
+            "Invalid 'database.timescale.compress_after' (must be a string)");
+      }
+      timescale.compressAfter = timescaleJson["compress_after"];
+    }
+  }
+
+  // Parse rollup intervals (optional), e.g. ["1m", "1h", "1d"]
+  if (databaseJson.contains("rollups")) {
+    if (!databaseJson["rollups"].is_array()) {
+      throw ConfigParseException(
+          "Invalid 'database.rollups' (must be an array of intervals)");
+    }
+    for (const auto &intervalJson : databaseJson["rollups"]) {
+      if (!intervalJson.is_string()) {
+        throw ConfigParseException(
+            "Invalid 'database.rollups' (must be an array of intervals)");
+      }
+      RollupInterval interval = parseRollupInterval(intervalJson);
+      auto &rollups = config.database.rollups;
+      if (std::find(rollups.begin(), rollups.end(), interval) ==
+          rollups.end()) {
+        rollups.push_back(interval);
+      }
+    }
+  }
+
+  // Parse writer settings (optional)
+  if (configJson.contains("writer") && configJson["writer"].is_object()) {
+    const auto &writerJson = configJson["writer"];
+    if (writerJson.contains("queue_capacity")) {
+      if (!writerJson["queue_capacity"].is_number_unsigned() ||
+          writerJson["queue_capacity"].get<size_t>() == 0) {
+        throw ConfigParseException(
+            "Invalid 'writer.queue_capacity' (must be a positive integer)");
+      }
+      config.writer.queueCapacity = writerJson["queue_capacity"];
+    }
+    if (writerJson.contains("overflow_policy") &&
+        writerJson["overflow_policy"].is_string()) {
+      config.writer.overflowPolicy =
+          parseOverflowPolicy(writerJson["overflow_policy"]);
+    }
+    if (writerJson.contains("spool_dir")) {
+      if (!writerJson["spool_dir"].is_string()) {
+        throw ConfigParseException(
+            "Invalid 'writer.spool_dir' (must be a string)");
+      }
+      config.writer.spoolDirectory = writerJson["spool_dir"];
+    }
+  }
+
+  // Parse tariff schedule (optional), e.g. night from "23:00" to "07:00"
+  if (configJson.contains("tariff")) {
+    const auto &tariffJson = configJson["tariff"];
+    if (!tariffJson.is_object()) {
+      throw ConfigParseException("Invalid 'tariff' (must be an object)");
+    }
+    if (tariffJson.contains("default_zone")) {
+      if (!tariffJson["default_zone"].is_string() ||
+          tariffJson["default_zone"].get<std::string>().empty()) {
+        throw ConfigParseException(
+            "Invalid 'tariff.default_zone' (must be a non-empty string)");
+      }
+      config.tariff.defaultZone = tariffJson["default_zone"];
+    }
+    if (tariffJson.contains("zones")) {
+      if (!tariffJson["zones"].is_array()) {
+        throw ConfigParseException(
+            "Invalid 'tariff.zones' (must be an array)");
+      }
+      for (const auto &zoneJson : tariffJson["zones"]) {
+        if (!zoneJson.is_object() || !zoneJson.contains("name") ||
+            !zoneJson["name"].is_string() ||
+            zoneJson["name"].get<std::string>().empty()) {
+          throw ConfigParseException("Tariff zone missing or invalid 'name'");
+        }
+        TariffZone zone;
+        zone.name = zoneJson["name"];
+        std::string context = "Tariff zone " + zone.name;
+        if (!zoneJson.contains("from") || !zoneJson.contains("to")) {
+          throw ConfigParseException(context + " needs 'from' and 'to'");
+        }
+        zone.fromMinute =
+            parseTimeOfDay(zoneJson["from"], context + " has invalid 'from'");
+        zone.toMinute =
+            parseTimeOfDay(zoneJson["to"], context + " has invalid 'to'");
+        config.tariff.zones.push_back(zone);
+      }
+    }
+  }
+
+  if (configJson.contains("state_file")) {
+    if (!configJson["state_file"].is_string()) {
+      throw ConfigParseException("Invalid 'state_file' (must be a string)");
+    }
+    config.stateFile = configJson["state_file"];
+  }
 
   // Parse devices
   if (!configJson.contains("devices") || !configJson["devices"].is_array()) {
@@ -82,6 +328,34 @@ Config ConfigParser::parse(const std::string &configPath) {
     }
     device.connection.stopBits = connJson["stop_bits"];
 
+    // Parse timeouts (optional)
+    if (connJson.contains("response_timeout_ms")) {
+      if (!connJson["response_timeout_ms"].is_number_unsigned() ||
+          connJson["response_timeout_ms"].get<int>() <= 0) {
+        throw ConfigParseException(
+            "Device " + std::to_string(device.id) +
+            " has invalid 'connection.response_timeout_ms' (must be a "
+            "positive integer)");
+      }
+      device.connection.responseTimeoutMs = connJson["response_timeout_ms"];
+    }
+
+    if (connJson.contains("byte_timeout_ms")) {
+      if (!connJson["byte_timeout_ms"].is_number_unsigned() ||
+          connJson["byte_timeout_ms"].get<int>() <= 0) {
+        throw ConfigParseException(
+            "Device " + std::to_string(device.id) +
+            " has invalid 'connection.byte_timeout_ms' (must be a positive "
+            "integer)");
+      }
+      device.connection.byteTimeoutMs = connJson["byte_timeout_ms"];
+    }
+
+    if (connJson.contains("auto_tune_timeout") &&
+        connJson["auto_tune_timeout"].is_boolean()) {
+      device.connection.autoTuneTimeout = connJson["auto_tune_timeout"];
+    }
+
     // Parse isZero (defaults to true for 0-based addressing)
     if (deviceJson.contains("isZero") && deviceJson["isZero"].is_boolean()) {
       device.isZero = deviceJson["isZero"];
@@ -96,6 +370,36 @@ Config ConfigParser::parse(const std::string &configPath) {
       device.enabled = true;
     }
 
+    // Parse read planning limits (optional)
+    if (deviceJson.contains("max_read_words")) {
+      if (!deviceJson["max_read_words"].is_number_unsigned() ||
+          deviceJson["max_read_words"].get<int>() < 1 ||
+          deviceJson["max_read_words"].get<int>() > 125) {
+        throw ConfigParseException("Device " + std::to_string(device.id) +
+                                   " has invalid 'max_read_words' (must be "
+                                   "between 1 and 125)");
+      }
+      device.maxReadWords = deviceJson["max_read_words"];
+    }
+
+    if (deviceJson.contains("max_read_gap")) {
+      if (!deviceJson["max_read_gap"].is_number_unsigned()) {
+        throw ConfigParseException("Device " + std::to_string(device.id) +
+                                   " has invalid 'max_read_gap' (must be a "
+                                   "non-negative integer)");
+      }
+      device.maxReadGap = deviceJson["max_read_gap"];
+    }
+
+    // Parse default word order of 32/64-bit registers (optional)
+    if (deviceJson.contains("word_order")) {
+      if (!deviceJson["word_order"].is_string()) {
+        throw ConfigParseException("Device " + std::to_string(device.id) +
+                                   " has invalid 'word_order'");
+      }
+      device.wordOrder = parseWordOrder(deviceJson["word_order"]);
+    }
+
     // Parse registers
     if (!deviceJson.contains("registers") ||
         !deviceJson["registers"].is_array()) {
@@ -139,11 +443,53 @@ Config ConfigParser::parse(const std::string &configPath) {
         reg.scale = 1.0;
       }
 
-      if (regJson.contains("preprocessing") &&
-          regJson["preprocessing"].is_boolean()) {
-        reg.preprocessing = regJson["preprocessing"];
+      if (regJson.contains("word_order")) {
+        if (!regJson["word_order"].is_string()) {
+          throw ConfigParseException("Register at address " +
+                                     std::to_string(reg.address) +
+                                     " has invalid 'word_order'");
+        }
+        reg.wordOrder = parseWordOrder(regJson["word_order"]);
       } else {
-        reg.preprocessing = false;
+        reg.wordOrder = device.wordOrder;
+      }
+
+      // Unit for the registers dictionary (optional)
+      if (regJson.contains("unit") && regJson["unit"].is_string()) {
+        reg.unit = regJson["unit"];
+      }
+
+      // Change detection tolerance (optional)
+      if (regJson.contains("compression")) {
+        reg.compression = parseCompression(
+            regJson["compression"],
+            "Register at address " + std::to_string(reg.address));
+      }
+
+      // Parse expression (optional)
+      if (regJson.contains("expression")) {
+        if (!regJson["expression"].is_string()) {
+          throw ConfigParseException("Register at address " +
+                                     std::to_string(reg.address) +
+                                     " has invalid 'expression'");
+        }
+        reg.expression = regJson["expression"];
+      }
+      if (regJson.contains("lookup")) {
+        reg.lookup = parseLookup(
+            regJson["lookup"],
+            "Register at address " + std::to_string(reg.address));
+      }
+      reg.preprocessing = !reg.expression.empty();
+
+      // The hard-coded preprocessing flag became an expression
+      if (regJson.contains("preprocessing") &&
+          regJson["preprocessing"].is_boolean() &&
+          regJson["preprocessing"].get<bool>() && !reg.preprocessing) {
+        throw ConfigParseException(
+            "Register at address " + std::to_string(reg.address) +
+            " sets 'preprocessing'; use an 'expression' instead, e.g. "
+            "\"precision_first(x)\"");
       }
 
       // Parse enabled (defaults to true if not specified)
@@ -153,9 +499,114 @@ Config ConfigParser::parse(const std::string &configPath) {
         reg.enabled = true;
       }
 
+      // Parse period (optional, overrides the enclosing range's period)
+      if (regJson.contains("period")) {
+        if (!regJson["period"].is_string()) {
+          throw ConfigParseException("Register at address " +
+                                     std::to_string(reg.address) +
+                                     " has invalid 'period'");
+        }
+        std::string periodStr = regJson["period"];
+        try {
+          PeriodParser::parsePeriod(periodStr);
+        } catch (const ConfigParseException &e) {
+          throw ConfigParseException("Register at address " +
+                                     std::to_string(reg.address) +
+                                     " has invalid period: " + e.what());
+        }
+        reg.period = periodStr;
+      }
+
+      // Parse heartbeat interval (optional)
+      if (regJson.contains("max_silence")) {
+        reg.maxSilence = parseMaxSilence(
+            regJson["max_silence"],
+            "Register at address " + std::to_string(reg.address));
+      }
+
+      // Parse energy-counter flag (optional)
+      if (regJson.contains("counter")) {
+        reg.counter = parseCounter(
+            regJson["counter"],
+            "Register at address " + std::to_string(reg.address));
+      }
+
+      if (device.registers.size() > UINT16_MAX) {
+        throw ConfigParseException("Device " + std::to_string(device.id) +
+                                   " has too many registers");
+      }
+      reg.id = static_cast<uint16_t>(device.registers.size());
       device.registers.push_back(reg);
     }
 
+    // Parse virtual registers (optional): computed from the registers above
+    // and stored like them
+    if (deviceJson.contains("virtual_registers")) {
+      if (!deviceJson["virtual_registers"].is_array()) {
+        throw ConfigParseException("Device " + std::to_string(device.id) +
+                                   " has invalid 'virtual_registers'");
+      }
+      for (const auto &regJson : deviceJson["virtual_registers"]) {
+        if (!regJson.contains("name") || !regJson["name"].is_string()) {
+          throw ConfigParseException(
+              "Virtual register missing or invalid 'name' in device " +
+              std::to_string(device.id));
+        }
+        RegisterDefinition reg;
+        reg.name = regJson["name"];
+        std::string context = "Virtual register " + reg.name;
+
+        if (!regJson.contains("expression") ||
+            !regJson["expression"].is_string()) {
+          throw ConfigParseException(context +
+                                     " missing or invalid 'expression'");
+        }
+        reg.expression = regJson["expression"];
+        reg.preprocessing = true;
+        reg.isVirtual = true;
+        reg.address = 0;
+        reg.type = RegisterType::Float32;
+        reg.regType = ModbusRegisterType::Holding;
+        reg.scale = 1.0;
+
+        if (regJson.contains("unit") && regJson["unit"].is_string()) {
+          reg.unit = regJson["unit"];
+        }
+        if (regJson.contains("lookup")) {
+          reg.lookup = parseLookup(regJson["lookup"], context);
+        }
+        if (regJson.contains("compression")) {
+          reg.compression = parseCompression(regJson["compression"], context);
+        }
+        if (regJson.contains("max_silence")) {
+          reg.maxSilence = parseMaxSilence(regJson["max_silence"], context);
+        }
+        if (regJson.contains("counter")) {
+          reg.counter = parseCounter(regJson["counter"], context);
+        }
+        if (regJson.contains("enabled") && regJson["enabled"].is_boolean()) {
+          reg.enabled = regJson["enabled"];
+        } else {
+          reg.enabled = true;
+        }
+
+        if (device.registers.size() > UINT16_MAX) {
+          throw ConfigParseException("Device " + std::to_string(device.id) +
+                                     " has too many registers");
+        }
+        reg.id = static_cast<uint16_t>(device.registers.size());
+        device.registers.push_back(reg);
+      }
+    }
+
+    // Check expressions and their references now rather than at startup
+    try {
+      compileExpressions(device.registers);
+    } catch (const ExpressionError &e) {
+      throw ConfigParseException("Device " + std::to_string(device.id) +
+                                 ": " + e.what());
+    }
+
     // Parse ranges (optional)
     if (deviceJson.contains("ranges") && deviceJson["ranges"].is_array()) {
       for (const auto &rangeJson : deviceJson["ranges"]) {
@@ -264,6 +715,21 @@ ConfigParser::parseModbusRegisterType(const std::string &regTypeStr) {
   }
 }
 
+WordOrder ConfigParser::parseWordOrder(const std::string &orderStr) {
+  if (orderStr == "ABCD") {
+    return WordOrder::ABCD;
+  } else if (orderStr == "CDAB") {
+    return WordOrder::CDAB;
+  } else if (orderStr == "BADC") {
+    return WordOrder::BADC;
+  } else if (orderStr == "DCBA") {
+    return WordOrder::DCBA;
+  } else {
+    throw ConfigParseException("Invalid word order: " + orderStr +
+                               " (must be ABCD, CDAB, BADC, or DCBA)");
+  }
+}
+
 char ConfigParser::parseParity(const std::string &parityStr) {
   if (parityStr == "N" || parityStr == "n") {
     return 'N';
@@ -277,4 +743,40 @@ char ConfigParser::parseParity(const std::string &parityStr) {
   }
 }
 
+OverflowPolicy ConfigParser::parseOverflowPolicy(const std::string &policyStr) {
+  if (policyStr == "drop_newest") {
+    return OverflowPolicy::DropNewest;
+  } else if (policyStr == "block") {
+    return OverflowPolicy::Block;
+  } else {
+    throw ConfigParseException("Invalid writer overflow policy: " + policyStr +
+                               " (must be drop_newest or block)");
+  }
+}
+
+StorageMode ConfigParser::parseStorageMode(const std::string &modeStr) {
+  if (modeStr == "narrow") {
+    return StorageMode::Narrow;
+  } else if (modeStr == "wide") {
+    return StorageMode::Wide;
+  } else {
+    throw ConfigParseException("Invalid database storage mode: " + modeStr +
+                               " (must be narrow or wide)");
+  }
+}
+
+RollupInterval
+ConfigParser::parseRollupInterval(const std::string &intervalStr) {
+  if (intervalStr == "1m") {
+    return RollupInterval::Minute;
+  } else if (intervalStr == "1h") {
+    return RollupInterval::Hour;
+  } else if (intervalStr == "1d") {
+    return RollupInterval::Day;
+  } else {
+    throw ConfigParseException("Invalid rollup interval: " + intervalStr +
+                               " (must be 1m, 1h or 1d)");
+  }
+}
+
 } // namespace ModbusLogger
@@ -14,7 +14,11 @@ public:
 private:
     static RegisterType parseRegisterType(const std::string& typeStr);
     static ModbusRegisterType parseModbusRegisterType(const std::string& regTypeStr);
+    static WordOrder parseWordOrder(const std::string& orderStr);
     static char parseParity(const std::string& parityStr);
+    static OverflowPolicy parseOverflowPolicy(const std::string& policyStr);
+    static StorageMode parseStorageMode(const std::string& modeStr);
+    static RollupInterval parseRollupInterval(const std::string& intervalStr);
 };
 
 class ConfigParseException : public std::runtime_error {
@@ -0,0 +1,35 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace ModbusLogger {
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320) used to validate
+// on-disk records
+inline uint32_t crc32(const void *data, size_t length, uint32_t crc = 0) {
+  static const std::array<uint32_t, 256> table = []() {
+    std::array<uint32_t, 256> result{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+      }
+      result[i] = value;
+    }
+    return result;
+  }();
+
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < length; ++i) {
+    crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+} // namespace ModbusLogger
+
+#endif // CRC32_H
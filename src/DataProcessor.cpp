@@ -1,13 +1,126 @@
 #include "DataProcessor.h"
+#include "ReadPlanner.h"
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <iostream>
 
 namespace ModbusLogger {
 
+namespace {
+// Value of Words registers laid out in Order, most significant word first
+template <WordOrder Order, size_t Words>
+uint64_t combineWords(const uint16_t *words) {
+  constexpr bool highWordFirst =
+      Order == WordOrder::ABCD || Order == WordOrder::BADC;
+  constexpr bool swapBytes =
+      Order == WordOrder::BADC || Order == WordOrder::DCBA;
+  uint64_t combined = 0;
+  for (size_t i = 0; i < Words; ++i) {
+    uint16_t word = words[highWordFirst ? i : Words - 1 - i];
+    if (swapBytes) {
+      word = static_cast<uint16_t>((word << 8) | (word >> 8));
+    }
+    combined = (combined << 16) | word;
+  }
+  return combined;
+}
+
+// Register decoders; words points at the register's first word
+double decodeInt16(const uint16_t *words) {
+  return static_cast<int16_t>(words[0]);
+}
+
+double decodeUint16(const uint16_t *words) { return words[0]; }
+
+template <WordOrder Order> double decodeInt32(const uint16_t *words) {
+  return static_cast<int32_t>(
+      static_cast<uint32_t>(combineWords<Order, 2>(words)));
+}
+
+template <WordOrder Order> double decodeUint32(const uint16_t *words) {
+  return static_cast<double>(combineWords<Order, 2>(words));
+}
+
+template <WordOrder Order> double decodeFloat32(const uint16_t *words) {
+  uint32_t combined = static_cast<uint32_t>(combineWords<Order, 2>(words));
+  float floatValue;
+  std::memcpy(&floatValue, &combined, sizeof(float));
+  return floatValue;
+}
+
+template <WordOrder Order> double decodeUint64(const uint16_t *words) {
+  return static_cast<double>(combineWords<Order, 4>(words));
+}
+
+// Branch-free loop over a run, which the compiler vectorizes for the
+// common runs of 16-bit registers
+template <double (*Decode)(const uint16_t *), size_t Words>
+void decodeRun(const uint16_t *words, const double *scales, double *values,
+               size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = Decode(words + i * Words) * scales[i];
+  }
+}
+
+template <WordOrder Order> DecodeKernel getMultiWordKernel(RegisterType type) {
+  switch (type) {
+  case RegisterType::Int32:
+    return decodeRun<decodeInt32<Order>, 2>;
+  case RegisterType::Uint32:
+    return decodeRun<decodeUint32<Order>, 2>;
+  case RegisterType::Float32:
+    return decodeRun<decodeFloat32<Order>, 2>;
+  case RegisterType::Uint64:
+    return decodeRun<decodeUint64<Order>, 4>;
+  default:
+    return nullptr;
+  }
+}
+
+// The word order is resolved here, once per plan, so no kernel branches on
+// it per value
+DecodeKernel getDecodeKernel(RegisterType type, WordOrder wordOrder) {
+  switch (type) {
+  case RegisterType::Int16:
+    return decodeRun<decodeInt16, 1>;
+  case RegisterType::Uint16:
+    return decodeRun<decodeUint16, 1>;
+  default:
+    break;
+  }
+
+  switch (wordOrder) {
+  case WordOrder::ABCD:
+    return getMultiWordKernel<WordOrder::ABCD>(type);
+  case WordOrder::CDAB:
+    return getMultiWordKernel<WordOrder::CDAB>(type);
+  case WordOrder::BADC:
+    return getMultiWordKernel<WordOrder::BADC>(type);
+  case WordOrder::DCBA:
+    return getMultiWordKernel<WordOrder::DCBA>(type);
+  default:
+    return nullptr;
+  }
+}
+} // namespace
+
 DataProcessor::DataProcessor() {}
 
-void DataProcessor::setPreprocessFunction(PreprocessFunction func) {
-  preprocessFunction = func;
+void DataProcessor::loadExpressions(
+    const std::vector<RegisterDefinition> &deviceRegisters) {
+  expressions = compileExpressions(deviceRegisters);
+  expressionIndex.assign(deviceRegisters.size(), -1);
+  virtualExpressions.clear();
+  for (size_t i = 0; i < expressions.size(); ++i) {
+    uint16_t id = expressions[i].registerId;
+    expressionIndex[id] = static_cast<int>(i);
+    if (deviceRegisters[id].isVirtual) {
+      virtualExpressions.push_back(i);
+    }
+  }
+  registerValues.assign(deviceRegisters.size(), 0.0);
+  updated.assign(deviceRegisters.size(), 0);
 }
 
 RegisterValue
@@ -16,7 +129,7 @@ DataProcessor::processRegister(const RegisterDefinition &regDef,
                                size_t index) {
   RegisterValue result;
   result.address = regDef.address;
-  result.name = regDef.name;
+  result.registerId = regDef.id;
   result.type = regDef.type;
   result.regType = regDef.regType;
   result.scale = regDef.scale;
@@ -29,7 +142,7 @@ DataProcessor::processRegister(const RegisterDefinition &regDef,
   // Apply scale
   value = applyScale(value, regDef.scale);
 
-  // Note: Preprocessing is deferred to second pass when all register values are
+  // Note: Expressions are deferred to second pass when all register values are
   // available
   result.processedValue = value;
   return result;
@@ -47,7 +160,6 @@ DataProcessor::processRegisters(const std::vector<RegisterDefinition> &regDefs,
   for (size_t i = 0; i < regDefs.size(); ++i) {
     RegisterValue value = processRegister(regDefs[i], rawValues, rawIndex);
     results.push_back(value);
-    registerValueMap[value.address] = value;
 
     // Advance rawIndex based on register type
     if (regDefs[i].type == RegisterType::Int16 ||
@@ -62,121 +174,187 @@ DataProcessor::processRegisters(const std::vector<RegisterDefinition> &regDefs,
     }
   }
 
-  // Second pass: apply preprocessing with full context (all register values
-  // available)
-  if (preprocessFunction) {
-    for (auto &result : results) {
-      const RegisterDefinition *regDef = nullptr;
-      for (const auto &def : regDefs) {
-        if (def.address == result.address) {
-          regDef = &def;
-          break;
-        }
-      }
-
-      if (regDef && regDef->preprocessing) {
-        result.processedValue =
-            applyPreprocessing(*regDef, result.processedValue);
-        // Update the map with the preprocessed value
-        registerValueMap[result.address] = result;
+  // Second pass: evaluate expressions in dependency order with full context
+  // (all register values available)
+  if (!expressions.empty()) {
+    std::vector<int> resultIndex(registerValues.size(), -1);
+    for (size_t i = 0; i < results.size(); ++i) {
+      registerValues[results[i].registerId] = results[i].processedValue;
+      updated[results[i].registerId] = 1;
+      resultIndex[results[i].registerId] = static_cast<int>(i);
+    }
+    for (const RegisterExpression &compiled : expressions) {
+      int i = resultIndex[compiled.registerId];
+      if (i < 0) {
+        continue;
       }
+      double value = compiled.expression.evaluate(results[i].processedValue,
+                                                  registerValues.data());
+      results[i].processedValue = value;
+      registerValues[compiled.registerId] = value;
     }
   }
 
   return results;
 }
 
-void DataProcessor::updateRegisterValueMap(const RegisterValue &value) {
-  registerValueMap[value.address] = value;
-}
+DecodePlan
+DataProcessor::compilePlan(const RangeDefinition &range,
+                           const std::vector<RegisterDefinition> &regDefs) {
+  DecodePlan plan;
+  uint32_t rangeEnd = static_cast<uint32_t>(range.start) + range.count;
 
-const RegisterValueMap &DataProcessor::getRegisterValueMap() const {
-  return registerValueMap;
-}
+  for (size_t i = 0; i < regDefs.size(); ++i) {
+    const RegisterDefinition &regDef = regDefs[i];
+    if (regDef.isVirtual || regDef.regType != range.regType ||
+        regDef.period != range.period || regDef.address < range.start ||
+        regDef.address >= rangeEnd) {
+      continue;
+    }
 
-double DataProcessor::applyScale(double value, double scale) {
-  return value * scale;
-}
+    uint16_t wordCount = ReadPlanner::getWordCount(regDef);
+    if (regDef.address + wordCount > rangeEnd) {
+      std::cerr << "Warning: Register at address " << regDef.address
+                << " extends beyond range response" << std::endl;
+      continue;
+    }
 
-double DataProcessor::convertToDouble(const RegisterDefinition &regDef,
-                                      const std::vector<uint16_t> &rawValues,
-                                      size_t index) {
-  switch (regDef.type) {
-  case RegisterType::Int16: {
-    if (index >= rawValues.size()) {
-      return 0.0;
+    DecodeStep step;
+    step.offset = regDef.address - range.start;
+    step.type = regDef.type;
+    step.wordOrder = regDef.wordOrder;
+    step.scale = regDef.scale;
+    step.address = regDef.address;
+    step.registerId = regDef.id;
+    step.registerIndex = i;
+    if (regDef.id < expressionIndex.size() && expressionIndex[regDef.id] >= 0) {
+      plan.expressionSteps.push_back(
+          {plan.steps.size(), static_cast<size_t>(expressionIndex[regDef.id])});
     }
-    int16_t value = static_cast<int16_t>(rawValues[index]);
-    return static_cast<double>(value);
+    plan.steps.push_back(step);
+    plan.scales.push_back(regDef.scale);
+    plan.wordCount =
+        std::max<size_t>(plan.wordCount, step.offset + wordCount);
   }
 
-  case RegisterType::Int32: {
-    if (index + 1 >= rawValues.size()) {
-      return 0.0;
+  // Evaluate in the dependency order of the compiled expressions
+  std::sort(plan.expressionSteps.begin(), plan.expressionSteps.end(),
+            [](const ExpressionStep &a, const ExpressionStep &b) {
+              return a.expression < b.expression;
+            });
+
+  // Group adjacent registers of one type and word order into runs
+  for (size_t i = 0; i < plan.steps.size(); ++i) {
+    const DecodeStep &step = plan.steps[i];
+    DecodeKernel kernel = getDecodeKernel(step.type, step.wordOrder);
+    if (!plan.runs.empty()) {
+      DecodeRun &run = plan.runs.back();
+      const DecodeStep &previous = plan.steps[i - 1];
+      if (run.kernel == kernel &&
+          step.offset ==
+              previous.offset + ReadPlanner::getWordCount(
+                                    regDefs[previous.registerIndex])) {
+        ++run.count;
+        continue;
+      }
     }
-    // Modbus registers are 16-bit, so int32 requires 2 registers
-    uint32_t low = rawValues[index];
-    uint32_t high = rawValues[index + 1];
-    int32_t value = static_cast<int32_t>((high << 16) | low);
-    return static_cast<double>(value);
+    plan.runs.push_back({step.offset, i, 1, kernel});
   }
 
-  case RegisterType::Float32: {
-    if (index + 1 >= rawValues.size()) {
-      return 0.0;
-    }
-    // Modbus registers are 16-bit, so float32 requires 2 registers
-    uint32_t low = rawValues[index];
-    uint32_t high = rawValues[index + 1];
-    uint32_t combined = (high << 16) | low;
+  return plan;
+}
 
-    float floatValue;
-    std::memcpy(&floatValue, &combined, sizeof(float));
-    return static_cast<double>(floatValue);
-  }
+void DataProcessor::decode(const DecodePlan &plan,
+                           const std::vector<uint16_t> &rawValues,
+                           std::vector<double> &values) {
+  values.resize(plan.steps.size());
 
-  case RegisterType::Uint16: {
-    if (index >= rawValues.size()) {
-      return 0.0;
+  if (rawValues.size() >= plan.wordCount) {
+    // Decode run by run
+    for (const DecodeRun &run : plan.runs) {
+      if (run.kernel != nullptr) {
+        run.kernel(rawValues.data() + run.offset,
+                   plan.scales.data() + run.firstStep,
+                   values.data() + run.firstStep, run.count);
+      } else {
+        std::fill_n(values.begin() + run.firstStep, run.count, 0.0);
+      }
     }
-    uint16_t value = rawValues[index];
-    return static_cast<double>(value);
+  } else {
+    decodeScalar(plan, rawValues, values);
   }
 
-  case RegisterType::Uint32: {
-    if (index + 1 >= rawValues.size()) {
-      return 0.0;
-    }
-    // Modbus registers are 16-bit, so uint32 requires 2 registers
-    uint32_t low = rawValues[index];
-    uint32_t high = rawValues[index + 1];
-    uint32_t value = (high << 16) | low;
-    return static_cast<double>(value);
+  // Second pass: evaluate expressions in dependency order, with the latest
+  // value of every register of the device available
+  if (expressions.empty()) {
+    return;
   }
+  for (size_t i = 0; i < plan.steps.size(); ++i) {
+    registerValues[plan.steps[i].registerId] = values[i];
+    updated[plan.steps[i].registerId] = 1;
+  }
+  for (const ExpressionStep &expressionStep : plan.expressionSteps) {
+    double &value = values[expressionStep.step];
+    value = expressions[expressionStep.expression].expression.evaluate(
+        value, registerValues.data());
+    registerValues[plan.steps[expressionStep.step].registerId] = value;
+  }
+}
 
-  case RegisterType::Uint64: {
-    if (index + 3 >= rawValues.size()) {
-      return 0.0;
-    }
-    // Modbus registers are 16-bit, so uint64 requires 4 registers
-    uint64_t reg0 = rawValues[index];
-    uint64_t reg1 = rawValues[index + 1];
-    uint64_t reg2 = rawValues[index + 2];
-    uint64_t reg3 = rawValues[index + 3];
-    uint64_t value = (reg3 << 48) | (reg2 << 32) | (reg1 << 16) | reg0;
-    return static_cast<double>(value);
+void DataProcessor::decodeScalar(const DecodePlan &plan,
+                                 const std::vector<uint16_t> &rawValues,
+                                 std::vector<double> &values) {
+  values.resize(plan.steps.size());
+  for (size_t i = 0; i < plan.steps.size(); ++i) {
+    const DecodeStep &step = plan.steps[i];
+    values[i] = applyScale(
+        convertToDouble(step.type, step.wordOrder, rawValues, step.offset),
+        step.scale);
   }
+}
 
-  default:
-    return 0.0;
+void DataProcessor::evaluateVirtual(std::vector<VirtualValue> &values) {
+  for (size_t index : virtualExpressions) {
+    const RegisterExpression &compiled = expressions[index];
+    bool inputsUpdated = false;
+    for (uint16_t dependency : compiled.expression.getDependencies()) {
+      inputsUpdated = inputsUpdated || updated[dependency];
+    }
+    if (!inputsUpdated) {
+      continue;
+    }
+
+    uint16_t id = compiled.registerId;
+    registerValues[id] =
+        compiled.expression.evaluate(registerValues[id], registerValues.data());
+    updated[id] = 1;
+    values.push_back({id, registerValues[id]});
   }
+  std::fill(updated.begin(), updated.end(), 0);
+}
+
+double DataProcessor::applyScale(double value, double scale) {
+  return value * scale;
 }
 
-double DataProcessor::applyPreprocessing(const RegisterDefinition &regDef,
-                                         double value) {
-  if (preprocessFunction) {
-    return preprocessFunction(regDef.address, value, registerValueMap);
+double DataProcessor::convertToDouble(const RegisterDefinition &regDef,
+                                      const std::vector<uint16_t> &rawValues,
+                                      size_t index) {
+  return convertToDouble(regDef.type, regDef.wordOrder, rawValues, index);
+}
+
+double DataProcessor::convertToDouble(RegisterType type, WordOrder wordOrder,
+                                      const std::vector<uint16_t> &rawValues,
+                                      size_t index) {
+  // Modbus registers are 16-bit, so wider types span several registers
+  DecodeKernel kernel = getDecodeKernel(type, wordOrder);
+  if (kernel == nullptr ||
+      index + ReadPlanner::getWordCount(type) > rawValues.size()) {
+    return 0.0;
   }
+  double scale = 1.0;
+  double value;
+  kernel(rawValues.data() + index, &scale, &value, 1);
   return value;
 }
 
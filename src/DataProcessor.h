@@ -1,34 +1,92 @@
 #ifndef DATAPROCESSOR_H
 #define DATAPROCESSOR_H
 
+#include "Expression.h"
 #include "Types.h"
 #include <vector>
-#include <map>
-#include <functional>
 
 namespace ModbusLogger {
 
+// Where one register sits in a range response and how to decode it
+struct DecodeStep {
+    uint16_t offset;       // Word offset in the response
+    RegisterType type;
+    WordOrder wordOrder;
+    double scale;
+    uint16_t address;
+    uint16_t registerId;
+    size_t registerIndex;  // Index into the register list the plan was compiled from
+};
+
+// A step whose value goes through an expression
+struct ExpressionStep {
+    size_t step;
+    size_t expression;     // Index into the processor's compiled expressions
+};
+
+// Decodes count registers of one type laid out back to back from words and
+// writes them scaled to values
+using DecodeKernel = void (*)(const uint16_t* words, const double* scales, double* values, size_t count);
+
+// Consecutive steps of one type and word order whose registers are adjacent
+// in the response
+struct DecodeRun {
+    uint16_t offset;       // Word offset of the first register
+    size_t firstStep;
+    size_t count;
+    DecodeKernel kernel;
+};
+
+// Decoding of one range, compiled once so each cycle runs without lookups
+// or allocations
+struct DecodePlan {
+    std::vector<DecodeStep> steps;
+    std::vector<DecodeRun> runs;
+    std::vector<double> scales;  // scales[i] is steps[i].scale
+    size_t wordCount = 0;        // Response words the steps cover
+    std::vector<ExpressionStep> expressionSteps;  // In evaluation order
+};
+
+// Value computed for a virtual register
+struct VirtualValue {
+    uint16_t registerId;
+    double value;
+};
+
 class DataProcessor {
 public:
-    using PreprocessFunction = std::function<double(uint16_t address, double value, const RegisterValueMap& allValues)>;
-
     DataProcessor();
     
-    void setPreprocessFunction(PreprocessFunction func);
+    // Compile the expressions of all registers of the device; call before
+    // compiling plans. Throws ExpressionError.
+    void loadExpressions(const std::vector<RegisterDefinition>& deviceRegisters);
     
     RegisterValue processRegister(const RegisterDefinition& regDef, const std::vector<uint16_t>& rawValues, size_t index);
     std::vector<RegisterValue> processRegisters(const std::vector<RegisterDefinition>& regDefs, const std::vector<uint16_t>& rawValues);
     
-    void updateRegisterValueMap(const RegisterValue& value);
-    const RegisterValueMap& getRegisterValueMap() const;
+    // Compile the decoding of every register of the given type and period
+    // that lies entirely inside range
+    DecodePlan compilePlan(const RangeDefinition& range, const std::vector<RegisterDefinition>& regDefs);
+    // Decode a range response; values[i] is the value of plan.steps[i]
+    void decode(const DecodePlan& plan, const std::vector<uint16_t>& rawValues, std::vector<double>& values);
+    // Without expressions, register by register with a bounds check each;
+    // what decode() falls back to for short responses
+    void decodeScalar(const DecodePlan& plan, const std::vector<uint16_t>& rawValues, std::vector<double>& values);
+
+    // Compute the virtual registers whose inputs were decoded since the last
+    // call, in dependency order, and append their values
+    void evaluateVirtual(std::vector<VirtualValue>& values);
 
 private:
     double applyScale(double value, double scale);
     double convertToDouble(const RegisterDefinition& regDef, const std::vector<uint16_t>& rawValues, size_t index);
-    double applyPreprocessing(const RegisterDefinition& regDef, double value);
+    double convertToDouble(RegisterType type, WordOrder wordOrder, const std::vector<uint16_t>& rawValues, size_t index);
 
-    PreprocessFunction preprocessFunction;
-    RegisterValueMap registerValueMap;
+    std::vector<RegisterExpression> expressions;  // In evaluation order
+    std::vector<int> expressionIndex;  // By register id; -1 = no expression
+    std::vector<double> registerValues;  // Latest value by register id
+    std::vector<size_t> virtualExpressions;  // Indices into expressions
+    std::vector<uint8_t> updated;  // By register id: since evaluateVirtual
 };
 
 } // namespace ModbusLogger
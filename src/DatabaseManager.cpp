@@ -1,26 +1,94 @@
 #include "DatabaseManager.h"
+#include <cmath>
+#include <cstdio>
+#include <ctime>
 #include <iostream>
+#include <iterator>
+#include <set>
 #include <stdexcept>
+#include <tuple>
 
 namespace ModbusLogger {
 
-DatabaseManager::DatabaseManager(const std::string& connectionString)
-    : connectionString(connectionString)
+namespace {
+// Batches at least this large are streamed with COPY instead of INSERT
+constexpr size_t COPY_MIN_ROWS = 500;
+constexpr const char* INSERT_SAMPLES_STATEMENT = "insert_samples";
+
+// Whole batch is bound as three parallel arrays, so the statement is parsed
+// and planned once per connection and each flush is a single round-trip.
+// Timestamps are passed as microseconds since the Unix epoch.
+constexpr const char* INSERT_SAMPLES_SQL =
+    "INSERT INTO modbus_samples (register_id, timestamp, value) "
+    "SELECT r, TIMESTAMPTZ 'epoch' + t * INTERVAL '1 microsecond', v "
+    "FROM unnest($1::smallint[], $2::bigint[], $3::double precision[]) "
+    "AS u(r, t, v)";
+
+// Same array binding for rollups; %s is the table. Partial buckets of the
+// same register and start are merged.
+constexpr const char* UPSERT_ROLLUPS_SQL =
+    "INSERT INTO %s AS r "
+    "(register_id, timestamp, min, max, avg, first, last, count) "
+    "SELECT i, TIMESTAMPTZ 'epoch' + t * INTERVAL '1 microsecond', "
+    "mn, mx, a, f, l, c "
+    "FROM unnest($1::smallint[], $2::bigint[], $3::double precision[], "
+    "$4::double precision[], $5::double precision[], $6::double precision[], "
+    "$7::double precision[], $8::integer[]) AS u(i, t, mn, mx, a, f, l, c) "
+    "ON CONFLICT (register_id, timestamp) DO UPDATE SET "
+    "min = LEAST(r.min, EXCLUDED.min), max = GREATEST(r.max, EXCLUDED.max), "
+    "avg = (r.avg * r.count + EXCLUDED.avg * EXCLUDED.count) / "
+    "(r.count + EXCLUDED.count), "
+    "last = EXCLUDED.last, count = r.count + EXCLUDED.count";
+
+std::string getRollupStatementName(RollupInterval interval) {
+    return "upsert_" + DatabaseManager::getRollupTableName(interval);
+}
+
+// Counter increases add up to the day's total of their zone. Written about
+// once a minute, so not prepared.
+constexpr const char* UPSERT_TARIFF_TOTALS_SQL =
+    "INSERT INTO modbus_tariff_totals AS r "
+    "(register_id, day, zone, energy, last_value, last_time) "
+    "SELECT i, d, z, e, l, TIMESTAMPTZ 'epoch' + t * INTERVAL '1 microsecond' "
+    "FROM unnest($1::smallint[], $2::date[], $3::text[], "
+    "$4::double precision[], $5::double precision[], $6::bigint[]) "
+    "AS u(i, d, z, e, l, t) "
+    "ON CONFLICT (register_id, day, zone) DO UPDATE SET "
+    "energy = r.energy + EXCLUDED.energy, last_value = EXCLUDED.last_value, "
+    "last_time = EXCLUDED.last_time";
+
+// Element of a text array literal
+std::string quoteArrayElement(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + '"';
+}
+} // namespace
+
+DatabaseManager::DatabaseManager(const DatabaseConfig& config)
+    : config(config)
 {
 }
 
 bool DatabaseManager::connect() {
+    statementsPrepared = false;
+    wideColumns.clear();
     try {
-        connection = std::make_unique<pqxx::connection>(connectionString);
+        connection = std::make_unique<pqxx::connection>(config.connectionString);
         if (!connection->is_open()) {
             lastError = "Failed to open database connection";
-            std::cerr << "Error: " << lastError << std::endl;
+            reportError();
             return false;
         }
         return true;
     } catch (const std::exception& e) {
         lastError = "Database connection error: " + std::string(e.what());
-        std::cerr << "Error: " << lastError << std::endl;
+        reportError();
         return false;
     }
 }
@@ -34,12 +102,13 @@ void DatabaseManager::disconnect() {
         connection->disconnect();
     }
     connection.reset();
+    statementsPrepared = false;
 }
 
 bool DatabaseManager::executeQuery(const std::string& query) {
     if (!isConnected()) {
         lastError = "Database not connected";
-        std::cerr << "Error: " << lastError << std::endl;
+        reportError();
         return false;
     }
 
@@ -50,7 +119,7 @@ bool DatabaseManager::executeQuery(const std::string& query) {
         return true;
     } catch (const std::exception& e) {
         lastError = "Query execution error: " + std::string(e.what());
-        std::cerr << "Error: " << lastError << std::endl;
+        reportError();
         return false;
     }
 }
@@ -58,7 +127,7 @@ bool DatabaseManager::executeQuery(const std::string& query) {
 bool DatabaseManager::tableExists(const std::string& tableName) {
     if (!isConnected()) {
         lastError = "Database not connected";
-        std::cerr << "Error: " << lastError << std::endl;
+        reportError();
         return false;
     }
 
@@ -75,9 +144,492 @@ bool DatabaseManager::tableExists(const std::string& tableName) {
         return false;
     } catch (const std::exception& e) {
         lastError = "Table existence check error: " + std::string(e.what());
-        std::cerr << "Error: " << lastError << std::endl;
+        reportError();
+        return false;
+    }
+}
+
+bool DatabaseManager::insertSamples(const std::vector<SampleRow>& rows, FlushStats& stats) {
+    stats.rows = 0;
+    stats.latency = std::chrono::microseconds(0);
+
+    if (rows.empty()) {
+        return true;
+    }
+
+    if (!isConnected()) {
+        lastError = "Database not connected";
+        reportError();
+        return false;
+    }
+
+    if (!prepareStatements()) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int16_t> ids;
+    if (!resolveRegisterIds(rows, ids)) {
+        return false;
+    }
+
+    try {
+        std::string registerIds = "{";
+        std::string timestamps = "{";
+        std::string values = "{";
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (i > 0) {
+                registerIds += ',';
+                timestamps += ',';
+                values += ',';
+            }
+            registerIds += std::to_string(ids[i]);
+            timestamps += std::to_string(toEpochMicros(rows[i].timestamp));
+            values += pqxx::to_string(rows[i].value);
+        }
+        registerIds += '}';
+        timestamps += '}';
+        values += '}';
+
+        pqxx::work txn(*connection);
+        txn.exec_prepared(INSERT_SAMPLES_STATEMENT, registerIds, timestamps, values);
+        txn.commit();
+    } catch (const std::exception& e) {
+        lastError = "Batch insert error: " + std::string(e.what());
+        reportError();
+        return false;
+    }
+
+    stats.rows = rows.size();
+    stats.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return true;
+}
+
+bool DatabaseManager::copySamples(const std::vector<SampleRow>& rows, FlushStats& stats) {
+    if (config.storageMode == StorageMode::Wide) {
+        return insertWideRows(rows, stats);
+    }
+
+    stats.rows = 0;
+    stats.latency = std::chrono::microseconds(0);
+
+    if (rows.empty()) {
+        return true;
+    }
+
+    if (!isConnected()) {
+        lastError = "Database not connected";
+        reportError();
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int16_t> ids;
+    if (!resolveRegisterIds(rows, ids)) {
+        return false;
+    }
+
+    try {
+        pqxx::work txn(*connection);
+#if PQXX_VERSION_MAJOR > 7 || (PQXX_VERSION_MAJOR == 7 && PQXX_VERSION_MINOR >= 7)
+        auto stream = pqxx::stream_to::table(txn, {"modbus_samples"},
+                                             {"register_id", "timestamp", "value"});
+#else
+        const std::vector<std::string> columns = {"register_id", "timestamp", "value"};
+        pqxx::stream_to stream(txn, "modbus_samples", columns);
+#endif
+        for (size_t i = 0; i < rows.size(); ++i) {
+            stream << std::make_tuple(ids[i], formatTimestamp(rows[i].timestamp),
+                                      rows[i].value);
+        }
+        stream.complete();
+        txn.commit();
+    } catch (const std::exception& e) {
+        lastError = "COPY error: " + std::string(e.what());
+        reportError();
+        return false;
+    }
+
+    stats.rows = rows.size();
+    stats.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return true;
+}
+
+bool DatabaseManager::writeSamples(const std::vector<SampleRow>& rows, FlushStats& stats) {
+    if (config.storageMode == StorageMode::Wide) {
+        return insertWideRows(rows, stats);
+    }
+    if (rows.size() >= COPY_MIN_ROWS) {
+        return copySamples(rows, stats);
+    }
+    return insertSamples(rows, stats);
+}
+
+bool DatabaseManager::writeRollups(const std::vector<RollupRow>& rows, FlushStats& stats) {
+    stats.rows = 0;
+    stats.latency = std::chrono::microseconds(0);
+
+    if (rows.empty()) {
+        return true;
+    }
+
+    if (!isConnected()) {
+        lastError = "Database not connected";
+        reportError();
+        return false;
+    }
+
+    if (!prepareStatements()) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int16_t> ids;
+    if (!resolveRegisterIds(rows, ids)) {
+        return false;
+    }
+
+    try {
+        pqxx::work txn(*connection);
+        for (RollupInterval interval : config.rollups) {
+            // Parallel arrays of the statement parameters
+            std::vector<std::string> arrays(8, "{");
+            auto append = [&arrays](size_t column, const std::string& element) {
+                if (arrays[column].size() > 1) {
+                    arrays[column] += ',';
+                }
+                arrays[column] += element;
+            };
+            for (size_t i = 0; i < rows.size(); ++i) {
+                const RollupRow& row = rows[i];
+                if (row.interval != interval) {
+                    continue;
+                }
+                append(0, std::to_string(ids[i]));
+                append(1, std::to_string(toEpochMicros(row.bucket)));
+                append(2, pqxx::to_string(row.min));
+                append(3, pqxx::to_string(row.max));
+                append(4, pqxx::to_string(row.avg));
+                append(5, pqxx::to_string(row.first));
+                append(6, pqxx::to_string(row.last));
+                append(7, std::to_string(row.count));
+            }
+            if (arrays[0].size() == 1) {
+                continue;
+            }
+            for (auto& array : arrays) {
+                array += '}';
+            }
+            txn.exec_prepared(getRollupStatementName(interval), arrays[0],
+                              arrays[1], arrays[2], arrays[3], arrays[4],
+                              arrays[5], arrays[6], arrays[7]);
+        }
+        txn.commit();
+    } catch (const std::exception& e) {
+        lastError = "Rollup insert error: " + std::string(e.what());
+        reportError();
+        return false;
+    }
+
+    stats.rows = rows.size();
+    stats.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return true;
+}
+
+bool DatabaseManager::writeTariffTotals(const std::vector<TariffRow>& rows, FlushStats& stats) {
+    stats.rows = 0;
+    stats.latency = std::chrono::microseconds(0);
+
+    if (rows.empty()) {
+        return true;
+    }
+
+    if (!isConnected()) {
+        lastError = "Database not connected";
+        reportError();
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int16_t> ids;
+    if (!resolveRegisterIds(rows, ids)) {
+        return false;
+    }
+
+    std::string registerArray = "{";
+    std::string dayArray = "{";
+    std::string zoneArray = "{";
+    std::string deltaArray = "{";
+    std::string lastArray = "{";
+    std::string timeArray = "{";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (i > 0) {
+            registerArray += ',';
+            dayArray += ',';
+            zoneArray += ',';
+            deltaArray += ',';
+            lastArray += ',';
+            timeArray += ',';
+        }
+        registerArray += std::to_string(ids[i]);
+        dayArray += rows[i].day;
+        zoneArray += quoteArrayElement(rows[i].zone);
+        deltaArray += pqxx::to_string(rows[i].delta);
+        lastArray += pqxx::to_string(rows[i].lastValue);
+        timeArray += std::to_string(toEpochMicros(rows[i].lastTime));
+    }
+    registerArray += '}';
+    dayArray += '}';
+    zoneArray += '}';
+    deltaArray += '}';
+    lastArray += '}';
+    timeArray += '}';
+
+    try {
+        pqxx::work txn(*connection);
+        txn.exec_params(UPSERT_TARIFF_TOTALS_SQL, registerArray, dayArray,
+                        zoneArray, deltaArray, lastArray, timeArray);
+        txn.commit();
+    } catch (const std::exception& e) {
+        lastError = "Tariff totals insert error: " + std::string(e.what());
+        reportError();
+        return false;
+    }
+
+    stats.rows = rows.size();
+    stats.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return true;
+}
+
+const DatabaseConfig& DatabaseManager::getConfig() const {
+    return config;
+}
+
+std::string DatabaseManager::getWideTableName(int deviceId) {
+    return "modbus_" + std::to_string(deviceId);
+}
+
+std::string DatabaseManager::getRollupTableName(RollupInterval interval) {
+    switch (interval) {
+    case RollupInterval::Minute:
+        return "modbus_rollup_1m";
+    case RollupInterval::Hour:
+        return "modbus_rollup_1h";
+    case RollupInterval::Day:
+    default:
+        return "modbus_rollup_1d";
+    }
+}
+
+bool DatabaseManager::insertWideRows(const std::vector<SampleRow>& rows, FlushStats& stats) {
+    stats.rows = 0;
+    stats.latency = std::chrono::microseconds(0);
+
+    if (rows.empty()) {
+        return true;
+    }
+
+    if (!isConnected()) {
+        lastError = "Database not connected";
+        reportError();
+        return false;
+    }
+
+    // Values of one range read share device and timestamp
+    std::map<std::pair<int, int64_t>, std::vector<const SampleRow*>> wideRows;
+    for (const SampleRow& row : rows) {
+        wideRows[{row.deviceId, toEpochMicros(row.timestamp)}].push_back(&row);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t skipped = 0;
+    try {
+        pqxx::work txn(*connection);
+        std::string query;
+        for (const auto& entry : wideRows) {
+            int deviceId = entry.first.first;
+            const std::set<std::string>& columns = getWideColumns(txn, deviceId);
+
+            std::string names = "\"timestamp\"";
+            std::string values = txn.quote(formatTimestamp(entry.second.front()->timestamp));
+            for (const SampleRow* row : entry.second) {
+                if (columns.count(row->registerName) == 0) {
+                    ++skipped;
+                    continue;
+                }
+                names += ", " + txn.quote_name(row->registerName);
+                values += ", " + (std::isfinite(row->value) ? pqxx::to_string(row->value)
+                                                            : std::string("NULL"));
+            }
+
+            query += "INSERT INTO " + txn.quote_name(getWideTableName(deviceId)) +
+                     " (" + names + ") VALUES (" + values + ");";
+        }
+
+        // All rows in one round-trip
+        txn.exec(query);
+        txn.commit();
+    } catch (const std::exception& e) {
+        lastError = "Wide row insert error: " + std::string(e.what());
+        reportError();
+        return false;
+    }
+
+    if (skipped > 0) {
+        std::cerr << "Warning: Skipped " << skipped
+                  << " values of registers without a column" << std::endl;
+    }
+
+    stats.rows = rows.size() - skipped;
+    stats.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return true;
+}
+
+const std::set<std::string>& DatabaseManager::getWideColumns(pqxx::work& txn, int deviceId) {
+    auto it = wideColumns.find(deviceId);
+    if (it != wideColumns.end()) {
+        return it->second;
+    }
+
+    std::set<std::string>& columns = wideColumns[deviceId];
+    pqxx::result result = txn.exec(
+        "SELECT column_name FROM information_schema.columns "
+        "WHERE table_schema = current_schema() AND table_name = " +
+        txn.quote(getWideTableName(deviceId)) +
+        " AND column_name <> 'timestamp'");
+    for (const auto& row : result) {
+        columns.insert(row[0].as<std::string>());
+    }
+    return columns;
+}
+
+template <typename Row>
+bool DatabaseManager::resolveRegisterIds(const std::vector<Row>& rows,
+                                         std::vector<int16_t>& ids) {
+    ids.resize(rows.size());
+
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        auto it = registerIds.find({rows[i].deviceId, rows[i].registerName});
+        if (it != registerIds.end()) {
+            ids[i] = it->second;
+        } else {
+            missing.push_back(i);
+        }
+    }
+
+    if (missing.empty()) {
+        return true;
+    }
+
+    // Committed on its own, so cached ids never refer to rolled back entries
+    try {
+        pqxx::work txn(*connection);
+        loadRegisterIds(txn);
+
+        std::set<std::pair<int, std::string>> unknown;
+        for (size_t i : missing) {
+            unknown.insert({rows[i].deviceId, rows[i].registerName});
+        }
+        for (auto it = unknown.begin(); it != unknown.end();) {
+            it = registerIds.count(*it) ? unknown.erase(it) : std::next(it);
+        }
+
+        // Names the dictionary does not know, e.g. imported or spooled rows
+        // of a register no longer configured
+        for (const auto& key : unknown) {
+            txn.exec("INSERT INTO registers (device_id, name) VALUES (" +
+                     std::to_string(key.first) + ", " + txn.quote(key.second) +
+                     ") ON CONFLICT (device_id, name) DO NOTHING");
+        }
+        if (!unknown.empty()) {
+            loadRegisterIds(txn);
+        }
+        txn.commit();
+    } catch (const std::exception& e) {
+        registerIds.clear();
+        lastError = "Register dictionary error: " + std::string(e.what());
+        reportError();
         return false;
     }
+
+    for (size_t i : missing) {
+        auto it = registerIds.find({rows[i].deviceId, rows[i].registerName});
+        if (it == registerIds.end()) {
+            lastError = "Register " + rows[i].registerName + " of device " +
+                        std::to_string(rows[i].deviceId) + " missing from dictionary";
+            reportError();
+            return false;
+        }
+        ids[i] = it->second;
+    }
+    return true;
+}
+
+void DatabaseManager::loadRegisterIds(pqxx::work& txn) {
+    registerIds.clear();
+    pqxx::result result = txn.exec("SELECT register_id, device_id, name FROM registers");
+    for (const auto& row : result) {
+        registerIds[{row[1].as<int>(), row[2].as<std::string>()}] =
+            static_cast<int16_t>(row[0].as<int>());
+    }
+}
+
+bool DatabaseManager::prepareStatements() {
+    if (statementsPrepared) {
+        return true;
+    }
+
+    // Prepared lazily (after the schema is ensured) and again after every
+    // reconnect, since prepared statements belong to the server session
+    try {
+        connection->prepare(INSERT_SAMPLES_STATEMENT, INSERT_SAMPLES_SQL);
+        // Rollup tables exist only for the configured intervals
+        for (RollupInterval interval : config.rollups) {
+            char sql[1024];
+            std::snprintf(sql, sizeof(sql), UPSERT_ROLLUPS_SQL,
+                          getRollupTableName(interval).c_str());
+            connection->prepare(getRollupStatementName(interval), sql);
+        }
+        statementsPrepared = true;
+        return true;
+    } catch (const std::exception& e) {
+        lastError = "Statement preparation error: " + std::string(e.what());
+        reportError();
+        return false;
+    }
+}
+
+void DatabaseManager::setErrorLogging(bool enabled) {
+    logErrors = enabled;
+}
+
+void DatabaseManager::reportError() const {
+    if (logErrors) {
+        std::cerr << "Error: " << lastError << std::endl;
+    }
+}
+
+std::string DatabaseManager::formatTimestamp(const std::chrono::system_clock::time_point& timestamp) {
+    // PostgreSQL ISO 8601 format in UTC with microsecond precision, as
+    // timestamptz stores it
+    auto timeT = std::chrono::system_clock::to_time_t(timestamp);
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  timestamp.time_since_epoch()) % 1000000;
+    std::tm tmInfo;
+    gmtime_r(&timeT, &tmInfo);
+    char timestampStr[64];
+    std::snprintf(timestampStr, sizeof(timestampStr),
+                  "%04d-%02d-%02d %02d:%02d:%02d.%06ld+00",
+                  tmInfo.tm_year + 1900, tmInfo.tm_mon + 1, tmInfo.tm_mday,
+                  tmInfo.tm_hour, tmInfo.tm_min, tmInfo.tm_sec,
+                  static_cast<long>(us.count()));
+    return timestampStr;
 }
 
 std::string DatabaseManager::getLastError() const {
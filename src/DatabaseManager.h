@@ -1,17 +1,26 @@
 #ifndef DATABASEMANAGER_H
 #define DATABASEMANAGER_H
 
+#include "Types.h"
+#include <chrono>
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <set>
 #include <pqxx/pqxx>
 
 namespace ModbusLogger {
 
+// Result of a single batched write
+struct FlushStats {
+    size_t rows = 0;
+    std::chrono::microseconds latency{0};
+};
+
 class DatabaseManager {
 public:
-    explicit DatabaseManager(const std::string& connectionString);
+    explicit DatabaseManager(const DatabaseConfig& config);
     ~DatabaseManager() = default;
 
     DatabaseManager(const DatabaseManager&) = delete;
@@ -23,15 +32,61 @@ public:
 
     bool executeQuery(const std::string& query);
     bool tableExists(const std::string& tableName);
+
+    // Write all rows in one transaction with the prepared insert statement
+    bool insertSamples(const std::vector<SampleRow>& rows, FlushStats& stats);
+
+    // Stream all rows with COPY modbus_samples FROM STDIN in one transaction
+    bool copySamples(const std::vector<SampleRow>& rows, FlushStats& stats);
+
+    // Write rows using COPY for large batches and INSERT otherwise
+    bool writeSamples(const std::vector<SampleRow>& rows, FlushStats& stats);
+
+    // Upsert rollup rows in one transaction; a bucket written before (e.g.
+    // the part before a restart) is merged with the new one
+    bool writeRollups(const std::vector<RollupRow>& rows, FlushStats& stats);
+
+    // Add counter increases to the per-day, per-zone totals in one
+    // statement; rows must not repeat a register, day and zone
+    bool writeTariffTotals(const std::vector<TariffRow>& rows, FlushStats& stats);
+
+    const DatabaseConfig& getConfig() const;
+    // Table of a device in wide storage mode
+    static std::string getWideTableName(int deviceId);
+    static std::string getRollupTableName(RollupInterval interval);
     
     std::string getLastError() const;
+    // Print errors as they happen (the default); getLastError() keeps the
+    // last one either way
+    void setErrorLogging(bool enabled);
+    // ISO 8601 in UTC, as PostgreSQL accepts it
+    static std::string formatTimestamp(const std::chrono::system_clock::time_point& timestamp);
 
     pqxx::connection& getConnection();
 
 private:
-    std::string connectionString;
+    bool prepareStatements();
+    // Register id of every row from the registers dictionary, adding names
+    // it does not know yet
+    template <typename Row>
+    bool resolveRegisterIds(const std::vector<Row>& rows, std::vector<int16_t>& ids);
+    void loadRegisterIds(pqxx::work& txn);
+    // Wide mode: one row per device and timestamp, values without a column
+    // in the device table are skipped
+    bool insertWideRows(const std::vector<SampleRow>& rows, FlushStats& stats);
+    const std::set<std::string>& getWideColumns(pqxx::work& txn, int deviceId);
+    void reportError() const;
+
+    DatabaseConfig config;
     std::unique_ptr<pqxx::connection> connection;
+    bool statementsPrepared = false; // Prepared statements live per connection
+    // Register ids by device and name; ids are permanent, so this outlives
+    // reconnects
+    std::map<std::pair<int, std::string>, int16_t> registerIds;
+    std::map<int, std::set<std::string>> wideColumns; // Per connection
+
     mutable std::string lastError;
+    bool logErrors = true;
 };
 
 } // namespace ModbusLogger
@@ -0,0 +1,471 @@
+#include "Expression.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr size_t MAX_STACK_DEPTH = 32;
+
+// Drop the leading digit d of an integer value and scale the rest by 10^-d
+double precisionFirst(double value) {
+  int64_t intValue = static_cast<int64_t>(std::round(value));
+
+  // Handle zero or negative values
+  if (intValue <= 0) {
+    return value;
+  }
+
+  // Find the highest power of 10 less than the value
+  int64_t powerOf10 = 1;
+  int64_t temp = intValue;
+  while (temp >= 10) {
+    powerOf10 *= 10;
+    temp /= 10;
+  }
+
+  int firstDigit = static_cast<int>(intValue / powerOf10);
+  int64_t remainingValue = intValue % powerOf10;
+  return static_cast<double>(remainingValue) * std::pow(10.0, -firstDigit);
+}
+
+int64_t toInteger(double value) {
+  return static_cast<int64_t>(std::llround(value));
+}
+} // namespace
+
+// Recursive-descent parser emitting bytecode in evaluation order
+class Expression::Parser {
+public:
+  Parser(const std::string &source, Expression &expression,
+         const std::function<uint16_t(const std::string &)> &resolveRegister)
+      : source(source), expression(expression),
+        resolveRegister(resolveRegister), position(0), depth(0) {}
+
+  void parse() {
+    parseComparison();
+    skipSpaces();
+    if (position < source.size()) {
+      fail("Unexpected '" + std::string(1, source[position]) + "'");
+    }
+  }
+
+private:
+  struct Function {
+    const char *name;
+    size_t minArgs;
+    size_t maxArgs;
+    Op op;
+  };
+
+  void fail(const std::string &message) const {
+    throw ExpressionError(message + " at position " +
+                          std::to_string(position) + " in '" + source + "'");
+  }
+
+  void skipSpaces() {
+    while (position < source.size() &&
+           std::isspace(static_cast<unsigned char>(source[position]))) {
+      ++position;
+    }
+  }
+
+  bool accept(const char *token) {
+    skipSpaces();
+    size_t length = std::char_traits<char>::length(token);
+    if (source.compare(position, length, token) == 0) {
+      position += length;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(const char *token) {
+    if (!accept(token)) {
+      fail(std::string("Expected '") + token + "'");
+    }
+  }
+
+  // Emit an instruction that pops pops values and pushes one
+  void emit(Op op, size_t pops, uint16_t registerId = 0,
+            double constant = 0.0) {
+    expression.code.push_back({op, registerId, constant});
+    depth = depth - pops + 1;
+    if (depth > MAX_STACK_DEPTH) {
+      fail("Expression nested too deeply");
+    }
+  }
+
+  void parseComparison() {
+    parseAdditive();
+    static const std::pair<const char *, Op> operators[] = {
+        {"<=", Op::LessEqual}, {">=", Op::GreaterEqual}, {"==", Op::Equal},
+        {"!=", Op::NotEqual},  {"<", Op::Less},          {">", Op::Greater}};
+    for (const auto &entry : operators) {
+      if (accept(entry.first)) {
+        parseAdditive();
+        emit(entry.second, 2);
+        return;
+      }
+    }
+  }
+
+  void parseAdditive() {
+    parseTerm();
+    while (true) {
+      if (accept("+")) {
+        parseTerm();
+        emit(Op::Add, 2);
+      } else if (accept("-")) {
+        parseTerm();
+        emit(Op::Subtract, 2);
+      } else {
+        return;
+      }
+    }
+  }
+
+  void parseTerm() {
+    parseUnary();
+    while (true) {
+      if (accept("*")) {
+        parseUnary();
+        emit(Op::Multiply, 2);
+      } else if (accept("/")) {
+        parseUnary();
+        emit(Op::Divide, 2);
+      } else if (accept("%")) {
+        parseUnary();
+        emit(Op::Modulo, 2);
+      } else {
+        return;
+      }
+    }
+  }
+
+  void parseUnary() {
+    if (accept("-")) {
+      parseUnary();
+      emit(Op::Negate, 1);
+    } else if (accept("+")) {
+      parseUnary();
+    } else {
+      parsePrimary();
+    }
+  }
+
+  void parsePrimary() {
+    skipSpaces();
+    if (position >= source.size()) {
+      fail("Unexpected end of expression");
+    }
+
+    char c = source[position];
+    if (c == '(') {
+      ++position;
+      parseComparison();
+      expect(")");
+    } else if (c == '[') {
+      size_t end = source.find(']', position + 1);
+      if (end == std::string::npos) {
+        fail("Unterminated register reference");
+      }
+      std::string name = source.substr(position + 1, end - position - 1);
+      uint16_t id = resolveRegister(name);
+      position = end + 1;
+      emit(Op::Register, 0, id);
+      if (std::find(expression.dependencies.begin(),
+                    expression.dependencies.end(),
+                    id) == expression.dependencies.end()) {
+        expression.dependencies.push_back(id);
+      }
+    } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      const char *start = source.c_str() + position;
+      char *end = nullptr;
+      double value = std::strtod(start, &end);
+      if (end == start) {
+        fail("Invalid number");
+      }
+      position += end - start;
+      emit(Op::Constant, 0, 0, value);
+    } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      size_t start = position;
+      while (position < source.size() &&
+             (std::isalnum(static_cast<unsigned char>(source[position])) ||
+              source[position] == '_')) {
+        ++position;
+      }
+      parseName(source.substr(start, position - start));
+    } else {
+      fail("Unexpected '" + std::string(1, c) + "'");
+    }
+  }
+
+  void parseName(const std::string &name) {
+    if (name == "x") {
+      emit(Op::Input, 0);
+      return;
+    }
+
+    static const Function functions[] = {
+        {"abs", 1, 1, Op::Abs},
+        {"round", 1, 1, Op::Round},
+        {"floor", 1, 1, Op::Floor},
+        {"ceil", 1, 1, Op::Ceil},
+        {"sqrt", 1, 1, Op::Sqrt},
+        {"min", 2, 2, Op::Min},
+        {"max", 2, 2, Op::Max},
+        {"pow", 2, 2, Op::Pow},
+        {"if", 3, 3, Op::If},
+        {"bit", 2, 2, Op::Bit},
+        {"bits", 3, 3, Op::Bits},
+        {"lookup", 1, 2, Op::Lookup},
+        {"precision_first", 1, 1, Op::PrecisionFirst}};
+    const Function *function = nullptr;
+    for (const auto &candidate : functions) {
+      if (name == candidate.name) {
+        function = &candidate;
+        break;
+      }
+    }
+    if (function == nullptr) {
+      fail("Unknown name '" + name + "'");
+    }
+
+    expect("(");
+    size_t args = 0;
+    if (!accept(")")) {
+      do {
+        parseComparison();
+        ++args;
+      } while (accept(","));
+      expect(")");
+    }
+    if (args < function->minArgs || args > function->maxArgs) {
+      fail("Wrong number of arguments to " + name);
+    }
+
+    Op op = function->op;
+    if (op == Op::Lookup && args == 2) {
+      op = Op::LookupOr;
+    }
+    emit(op, args);
+  }
+
+  const std::string &source;
+  Expression &expression;
+  const std::function<uint16_t(const std::string &)> &resolveRegister;
+  size_t position;
+  size_t depth; // Stack depth after the code emitted so far
+};
+
+Expression::Expression(
+    const std::string &source, const std::map<int64_t, double> &lookup,
+    const std::function<uint16_t(const std::string &)> &resolveRegister)
+    : table(lookup.begin(), lookup.end()) {
+  Parser(source, *this, resolveRegister).parse();
+}
+
+double Expression::evaluate(double input, const double *registerValues) const {
+  double stack[MAX_STACK_DEPTH];
+  size_t top = 0; // Number of values on the stack
+
+  for (const Instruction &instruction : code) {
+    double *operands = stack + top;
+    switch (instruction.op) {
+    case Op::Constant:
+      stack[top++] = instruction.constant;
+      break;
+    case Op::Input:
+      stack[top++] = input;
+      break;
+    case Op::Register:
+      stack[top++] = registerValues[instruction.registerId];
+      break;
+    case Op::Negate:
+      operands[-1] = -operands[-1];
+      break;
+    case Op::Add:
+      operands[-2] += operands[-1];
+      --top;
+      break;
+    case Op::Subtract:
+      operands[-2] -= operands[-1];
+      --top;
+      break;
+    case Op::Multiply:
+      operands[-2] *= operands[-1];
+      --top;
+      break;
+    case Op::Divide:
+      operands[-2] /= operands[-1];
+      --top;
+      break;
+    case Op::Modulo:
+      operands[-2] = std::fmod(operands[-2], operands[-1]);
+      --top;
+      break;
+    case Op::Less:
+      operands[-2] = operands[-2] < operands[-1] ? 1.0 : 0.0;
+      --top;
+      break;
+    case Op::LessEqual:
+      operands[-2] = operands[-2] <= operands[-1] ? 1.0 : 0.0;
+      --top;
+      break;
+    case Op::Greater:
+      operands[-2] = operands[-2] > operands[-1] ? 1.0 : 0.0;
+      --top;
+      break;
+    case Op::GreaterEqual:
+      operands[-2] = operands[-2] >= operands[-1] ? 1.0 : 0.0;
+      --top;
+      break;
+    case Op::Equal:
+      operands[-2] = operands[-2] == operands[-1] ? 1.0 : 0.0;
+      --top;
+      break;
+    case Op::NotEqual:
+      operands[-2] = operands[-2] != operands[-1] ? 1.0 : 0.0;
+      --top;
+      break;
+    case Op::Abs:
+      operands[-1] = std::abs(operands[-1]);
+      break;
+    case Op::Round:
+      operands[-1] = std::round(operands[-1]);
+      break;
+    case Op::Floor:
+      operands[-1] = std::floor(operands[-1]);
+      break;
+    case Op::Ceil:
+      operands[-1] = std::ceil(operands[-1]);
+      break;
+    case Op::Sqrt:
+      operands[-1] = std::sqrt(operands[-1]);
+      break;
+    case Op::Min:
+      operands[-2] = std::min(operands[-2], operands[-1]);
+      --top;
+      break;
+    case Op::Max:
+      operands[-2] = std::max(operands[-2], operands[-1]);
+      --top;
+      break;
+    case Op::Pow:
+      operands[-2] = std::pow(operands[-2], operands[-1]);
+      --top;
+      break;
+    case Op::If:
+      operands[-3] = operands[-3] != 0.0 ? operands[-2] : operands[-1];
+      top -= 2;
+      break;
+    case Op::Bit:
+      operands[-2] = static_cast<double>(
+          (toInteger(operands[-2]) >> (toInteger(operands[-1]) & 63)) & 1);
+      --top;
+      break;
+    case Op::Bits: {
+      int64_t count = toInteger(operands[-1]);
+      uint64_t mask = count >= 64 ? ~uint64_t(0)
+                      : count <= 0 ? 0
+                                   : (uint64_t(1) << count) - 1;
+      uint64_t value = static_cast<uint64_t>(toInteger(operands[-3]));
+      operands[-3] = static_cast<double>(
+          (value >> (toInteger(operands[-2]) & 63)) & mask);
+      top -= 2;
+      break;
+    }
+    case Op::Lookup:
+      operands[-1] = lookupValue(operands[-1], operands[-1]);
+      break;
+    case Op::LookupOr:
+      operands[-2] = lookupValue(operands[-2], operands[-1]);
+      --top;
+      break;
+    case Op::PrecisionFirst:
+      operands[-1] = precisionFirst(operands[-1]);
+      break;
+    }
+  }
+
+  return top > 0 ? stack[top - 1] : std::numeric_limits<double>::quiet_NaN();
+}
+
+const std::vector<uint16_t> &Expression::getDependencies() const {
+  return dependencies;
+}
+
+double Expression::lookupValue(double value, double fallback) const {
+  int64_t key = toInteger(value);
+  auto it = std::lower_bound(
+      table.begin(), table.end(), key,
+      [](const std::pair<int64_t, double> &entry, int64_t k) {
+        return entry.first < k;
+      });
+  return it != table.end() && it->first == key ? it->second : fallback;
+}
+
+std::vector<RegisterExpression>
+compileExpressions(const std::vector<RegisterDefinition> &registers) {
+  std::map<std::string, const RegisterDefinition *> byName;
+  for (const auto &reg : registers) {
+    byName[reg.name] = &reg;
+  }
+
+  std::map<uint16_t, Expression> compiled;
+  for (const auto &reg : registers) {
+    if (reg.expression.empty()) {
+      continue;
+    }
+    auto resolve = [&](const std::string &name) -> uint16_t {
+      auto it = byName.find(name);
+      if (it == byName.end()) {
+        throw ExpressionError("Unknown register [" + name + "]");
+      }
+      if (!it->second->enabled) {
+        throw ExpressionError("Disabled register [" + name + "]");
+      }
+      return it->second->id;
+    };
+    try {
+      Expression expression(reg.expression, reg.lookup, resolve);
+      if (reg.isVirtual && expression.getDependencies().empty()) {
+        throw ExpressionError("Virtual register references no registers");
+      }
+      compiled.emplace(reg.id, expression);
+    } catch (const ExpressionError &e) {
+      throw ExpressionError("Register " + reg.name + ": " + e.what());
+    }
+  }
+
+  // Depth-first topological order over references between expressions
+  enum class Mark { None, Visiting, Done };
+  std::map<uint16_t, Mark> marks;
+  std::vector<RegisterExpression> ordered;
+  std::function<void(uint16_t)> visit = [&](uint16_t id) {
+    auto it = compiled.find(id);
+    if (it == compiled.end() || marks[id] == Mark::Done) {
+      return;
+    }
+    if (marks[id] == Mark::Visiting) {
+      throw ExpressionError("Expression of register " + registers[id].name +
+                            " depends on itself");
+    }
+    marks[id] = Mark::Visiting;
+    for (uint16_t dependency : it->second.getDependencies()) {
+      visit(dependency);
+    }
+    marks[id] = Mark::Done;
+    ordered.push_back({id, it->second});
+  };
+  for (const auto &entry : compiled) {
+    visit(entry.first);
+  }
+  return ordered;
+}
+
+} // namespace ModbusLogger
@@ -0,0 +1,103 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include "Types.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ModbusLogger {
+
+class ExpressionError : public std::runtime_error {
+public:
+  explicit ExpressionError(const std::string &message)
+      : std::runtime_error(message) {}
+};
+
+// Formula computing a register's value from its decoded (scaled) value x and
+// the values of other registers of the device, written [name]. Supports
+// + - * / %, comparisons, parentheses and the functions abs, round, floor,
+// ceil, sqrt, min, max, pow, if(cond, a, b), bit(v, n), bits(v, start, count),
+// lookup(v[, fallback]) over the register's lookup table and
+// precision_first(v). Compiled once into bytecode for a small stack machine.
+class Expression {
+public:
+  // resolveRegister maps a referenced name to its register id or throws
+  Expression(const std::string &source,
+             const std::map<int64_t, double> &lookup,
+             const std::function<uint16_t(const std::string &)>
+                 &resolveRegister);
+
+  // registerValues is indexed by register id
+  double evaluate(double input, const double *registerValues) const;
+
+  // Ids of the registers referenced
+  const std::vector<uint16_t> &getDependencies() const;
+
+private:
+  enum class Op : uint8_t {
+    Constant,
+    Input,
+    Register,
+    Negate,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    Abs,
+    Round,
+    Floor,
+    Ceil,
+    Sqrt,
+    Min,
+    Max,
+    Pow,
+    If,
+    Bit,
+    Bits,
+    Lookup,
+    LookupOr,
+    PrecisionFirst
+  };
+
+  struct Instruction {
+    Op op;
+    uint16_t registerId; // Op::Register
+    double constant;     // Op::Constant
+  };
+
+  class Parser;
+
+  double lookupValue(double value, double fallback) const;
+
+  std::vector<Instruction> code;
+  std::vector<std::pair<int64_t, double>> table; // Sorted by key
+  std::vector<uint16_t> dependencies;
+};
+
+// A register's compiled expression
+struct RegisterExpression {
+  uint16_t registerId;
+  Expression expression;
+};
+
+// Compile the expressions of a device's registers, ordered so that each comes
+// after those of the registers it references. Throws ExpressionError on
+// syntax errors, unknown or disabled references and reference cycles.
+std::vector<RegisterExpression>
+compileExpressions(const std::vector<RegisterDefinition> &registers);
+
+} // namespace ModbusLogger
+
+#endif // EXPRESSION_H
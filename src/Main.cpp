@@ -1,24 +1,36 @@
+#include "AsyncWriter.h"
 #include "ConfigParser.h"
 #include "DaemonManager.h"
 #include "DataProcessor.h"
 #include "DatabaseManager.h"
+#include "ModbusBus.h"
 #include "ModbusClient.h"
 #include "PeriodParser.h"
 #include "PeriodicScheduler.h"
+#include "ReadPlanner.h"
+#include "RegisterState.h"
+#include "RollupAggregator.h"
+#include "StateSnapshot.h"
 #include "SchemaManager.h"
+#include "TariffAccumulator.h"
 #include <algorithm>
 #include <atomic>
+#include <cctype>
 #include <cerrno>
 #include <chrono>
 #include <cmath>
 #include <csignal>
 #include <cstdio>
 #include <cstring>
+#include <ctime>
 #include <filesystem>
+#include <fstream>
 #include <getopt.h>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <pqxx/pqxx>
 #include <sstream>
 #include <string>
@@ -32,18 +44,20 @@ constexpr const char *DEFAULT_LOG_FILE =
     "/var/log/modbuslogger/modbuslogger.log";
 constexpr int DEFAULT_DEVICE_ID = 1;
 constexpr int MAX_RETRIES = 3;
-constexpr int RETRY_DELAY_MS = 400;
-constexpr int READ_DELAY_MS = 400;
-constexpr int POST_RETRY_DELAY_MS = 300;
 constexpr double VALUE_EPSILON = 1e-9;
-constexpr const char *TABLE_NAME = "modbus_data";
-constexpr uint16_t REGISTER_540 = 540;
-constexpr uint16_t REGISTER_541 = 541;
-constexpr int DEVICE_ID_1 = 1;
-constexpr uint16_t MAX_BATCH_WORDS = 100;
-constexpr int REPEAT_DATA_PERIOD =
-    180; // store the same value when it is not changed during 180 periods
-         // (approx. 20*180=3600 seconds = 1 hour)
+constexpr const char *SAMPLES_TABLE_NAME = "modbus_samples";
+constexpr const char *REGISTERS_TABLE_NAME = "registers";
+constexpr const char *TARIFF_TOTALS_TABLE_NAME = "modbus_tariff_totals";
+constexpr size_t IMPORT_CHUNK_ROWS = 50000;
+constexpr auto STATS_LOG_INTERVAL = std::chrono::minutes(5);
+// How far back the last value of a register is looked up without a snapshot
+constexpr const char *LAST_VALUE_WINDOW = "1 day";
+constexpr auto MODBUS_RECONNECT_DELAY = std::chrono::seconds(5);
+constexpr auto SHUTDOWN_POLL_INTERVAL = std::chrono::milliseconds(500);
+// Default heartbeat: rewrite an unchanged value after 180 read periods
+constexpr int DEFAULT_SILENCE_PERIODS = 180;
+// How often counter increases are added to the tariff totals
+constexpr auto TARIFF_FLUSH_INTERVAL = std::chrono::minutes(1);
 
 std::atomic<bool> g_shutdownRequested(false);
 
@@ -62,62 +76,6 @@ std::string quoteIdentifier(const std::string &identifier) {
 
 void shutdownHandler() { g_shutdownRequested = true; }
 
-double preprocessPrecisionFirst(double value) {
-
-  int64_t intValue = static_cast<int64_t>(std::round(value));
-
-  // Handle zero or negative values
-  if (intValue <= 0) {
-    return value;
-  }
-
-  // Find the highest power of 10 less than the value
-  int64_t powerOf10 = 1;
-  int64_t temp = intValue;
-  while (temp >= 10) {
-    powerOf10 *= 10;
-    temp /= 10;
-  }
-
-  // Extract first digit
-  int firstDigit = static_cast<int>(intValue / powerOf10);
-
-  // Remove first digit from value
-  int64_t remainingValue = intValue % powerOf10;
-
-  // Apply scaling: multiply by 10^(-firstDigit)
-  double scale = std::pow(10.0, -firstDigit);
-  return static_cast<double>(remainingValue) * scale;
-}
-
-ModbusLogger::DataProcessor::PreprocessFunction
-createPreprocessFunction(int deviceId) {
-  return [deviceId](
-             uint16_t address, double value,
-             const ModbusLogger::RegisterValueMap & /* allValues */) -> double {
-    // Process register 540 for device ID 1
-    if (deviceId == DEVICE_ID_1) {
-      if (address == REGISTER_540) {
-        return preprocessPrecisionFirst(value);
-      }
-    }
-    // For other registers, return value unchanged
-    return value;
-  };
-}
-
-uint16_t getRegisterWordCount(const ModbusLogger::RegisterDefinition &reg) {
-  if (reg.type == ModbusLogger::RegisterType::Int32 ||
-      reg.type == ModbusLogger::RegisterType::Float32 ||
-      reg.type == ModbusLogger::RegisterType::Uint32) {
-    return 2;
-  } else if (reg.type == ModbusLogger::RegisterType::Uint64) {
-    return 4;
-  } else {
-    return 1;
-  }
-}
-
 uint16_t getAdjustedAddress(uint16_t address, bool isZero) {
   if (!isZero) {
     if (address == 0) {
@@ -184,14 +142,9 @@ bool readRange(ModbusLogger::ModbusClient &modbusClient,
 
     if (readSuccess) {
       success = true;
-      if (attemptNumber > 0) {
-        if (verbose) {
-          std::cerr << "  Range read succeeded after " << attemptNumber
-                    << " retries" << std::endl;
-        }
-        modbusClient.flushBuffer();
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(POST_RETRY_DELAY_MS));
+      if (attemptNumber > 0 && verbose) {
+        std::cerr << "  Range read succeeded after " << attemptNumber
+                  << " retries" << std::endl;
       }
       break;
     }
@@ -205,7 +158,7 @@ bool readRange(ModbusLogger::ModbusClient &modbusClient,
                   << "): " << lastError << std::endl;
       }
       modbusClient.flushBuffer();
-      std::this_thread::sleep_for(std::chrono::milliseconds(RETRY_DELAY_MS));
+      modbusClient.waitInterFrameDelay();
     }
   }
 
@@ -219,7 +172,7 @@ bool readRange(ModbusLogger::ModbusClient &modbusClient,
   }
 
   modbusClient.flushBuffer();
-  std::this_thread::sleep_for(std::chrono::milliseconds(READ_DELAY_MS));
+  modbusClient.waitInterFrameDelay();
 
   if (verbose) {
     uint16_t endAddress = range.start + count - 1;
@@ -296,14 +249,9 @@ bool readBatch(ModbusLogger::ModbusClient &modbusClient,
 
     if (readSuccess) {
       success = true;
-      if (attemptNumber > 0) {
-        if (verbose) {
-          std::cerr << "  Batch read succeeded after " << attemptNumber
-                    << " retries" << std::endl;
-        }
-        modbusClient.flushBuffer();
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(POST_RETRY_DELAY_MS));
+      if (attemptNumber > 0 && verbose) {
+        std::cerr << "  Batch read succeeded after " << attemptNumber
+                  << " retries" << std::endl;
       }
       break;
     }
@@ -318,7 +266,7 @@ bool readBatch(ModbusLogger::ModbusClient &modbusClient,
                   << "): " << lastError << std::endl;
       }
       modbusClient.flushBuffer();
-      std::this_thread::sleep_for(std::chrono::milliseconds(RETRY_DELAY_MS));
+      modbusClient.waitInterFrameDelay();
     }
   }
 
@@ -338,7 +286,7 @@ bool readBatch(ModbusLogger::ModbusClient &modbusClient,
   }
 
   modbusClient.flushBuffer();
-  std::this_thread::sleep_for(std::chrono::milliseconds(READ_DELAY_MS));
+  modbusClient.waitInterFrameDelay();
 
   // Log register range
   uint16_t endAddress = batch.startAddress + batch.totalWords - 1;
@@ -355,7 +303,7 @@ bool readBatch(ModbusLogger::ModbusClient &modbusClient,
     uint16_t regAddress =
         getAdjustedAddress(reg->address, deviceConfig->isZero);
     uint16_t offset = regAddress - batch.startAddress;
-    uint16_t wordCount = getRegisterWordCount(*reg);
+    uint16_t wordCount = ModbusLogger::ReadPlanner::getWordCount(*reg);
 
     if (offset + wordCount > batchValues.size()) {
       std::cerr << "Error: Register at address " << reg->address
@@ -390,77 +338,163 @@ bool readBatch(ModbusLogger::ModbusClient &modbusClient,
   return true;
 }
 
-// Custom stream buffer that adds timestamps to each line
+// Split one CSV line into fields, honouring double-quoted fields
+std::vector<std::string> splitCsvLine(const std::string &line) {
+  std::vector<std::string> fields;
+  std::string field;
+  bool inQuotes = false;
+  for (size_t i = 0; i < line.size(); ++i) {
+    char c = line[i];
+    if (inQuotes) {
+      if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+        field += '"';
+        ++i;
+      } else if (c == '"') {
+        inQuotes = false;
+      } else {
+        field += c;
+      }
+    } else if (c == '"') {
+      inQuotes = true;
+    } else if (c == ',') {
+      fields.push_back(field);
+      field.clear();
+    } else if (c != '\r') {
+      field += c;
+    }
+  }
+  fields.push_back(field);
+  return fields;
+}
+
+// Parse "YYYY-MM-DD HH:MM:SS[.ffffff]" (UTC) into a time point; fraction
+// digits past microseconds are ignored
+bool parseUtcTimestamp(const std::string &text,
+                       std::chrono::system_clock::time_point &timestamp) {
+  std::tm tmInfo{};
+  int end = 0;
+  int parsed = std::sscanf(text.c_str(), "%d-%d-%d%*[ T]%d:%d:%d%n",
+                           &tmInfo.tm_year, &tmInfo.tm_mon, &tmInfo.tm_mday,
+                           &tmInfo.tm_hour, &tmInfo.tm_min, &tmInfo.tm_sec,
+                           &end);
+  if (parsed < 6) {
+    return false;
+  }
+
+  // The fraction is a digit string: ".5" is 500000 us, not 5
+  int64_t micros = 0;
+  size_t pos = static_cast<size_t>(end);
+  if (pos < text.size() && text[pos] == '.') {
+    int digits = 0;
+    ++pos;
+    while (pos < text.size() &&
+           std::isdigit(static_cast<unsigned char>(text[pos]))) {
+      if (digits < 6) {
+        micros = micros * 10 + (text[pos] - '0');
+        ++digits;
+      }
+      ++pos;
+    }
+    for (; digits < 6; ++digits) {
+      micros *= 10;
+    }
+  }
+
+  tmInfo.tm_year -= 1900;
+  tmInfo.tm_mon -= 1;
+  std::time_t timeT = timegm(&tmInfo);
+  timestamp = std::chrono::system_clock::from_time_t(timeT) +
+              std::chrono::microseconds(micros);
+  return true;
+}
+
+// Custom stream buffer that adds timestamps to each line.
+// Shared by the poll and writer threads: each thread collects its own line,
+// which is written in one piece once it is complete, so lines never mix.
 class TimestampStreambuf : public std::streambuf {
 public:
-  TimestampStreambuf(FILE *file) : file_(file), atStartOfLine_(true) {
-    // Set buffer
-    setp(buffer_, buffer_ + sizeof(buffer_) - 1);
+  TimestampStreambuf(FILE *file) : file_(file) {
+    // No put area, so every character reaches overflow() or xsputn()
+    setp(nullptr, nullptr);
   }
 
   ~TimestampStreambuf() override {
     if (file_ != nullptr) {
-      sync();
+      std::string &line = pendingLine();
+      if (!line.empty()) {
+        writeLine(line);
+        line.clear();
+      }
     }
   }
 
 protected:
+  std::streamsize xsputn(const char *s, std::streamsize count) override {
+    std::string &line = pendingLine();
+    const char *end = s + count;
+    while (s != end) {
+      const char *newline = static_cast<const char *>(
+          std::memchr(s, '\n', static_cast<size_t>(end - s)));
+      if (newline == nullptr) {
+        line.append(s, end);
+        break;
+      }
+      line.append(s, newline + 1);
+      writeLine(line);
+      line.clear();
+      s = newline + 1;
+    }
+    return count;
+  }
+
   int overflow(int c) override {
     if (c != EOF) {
-      *pptr() = static_cast<char>(c);
-      pbump(1);
+      char ch = static_cast<char>(c);
+      xsputn(&ch, 1);
     }
-    return (flushBuffer() == EOF) ? EOF : c;
+    return c == EOF ? 0 : c;
   }
 
-  int sync() override { return flushBuffer(); }
+  // Complete lines are written as they end; an unfinished one waits for
+  // its newline
+  int sync() override { return 0; }
 
 private:
-  int flushBuffer() {
-    if (pbase() == pptr()) {
-      return 0; // Buffer is empty
-    }
-
-    std::string line(pbase(), pptr());
-    setp(buffer_, buffer_ + sizeof(buffer_) - 1);
-
-    // Add timestamp at start of line
-    if (atStartOfLine_) {
-      auto now = std::chrono::system_clock::now();
-      auto time = std::chrono::system_clock::to_time_t(now);
-      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    now.time_since_epoch()) %
-                1000;
-
-      std::tm *tm_info = std::localtime(&time);
-      char timestamp[64];
-      std::snprintf(timestamp, sizeof(timestamp),
-                    "[%04d-%02d-%02d %02d:%02d:%02d.%03ld] ",
-                    tm_info->tm_year + 1900, tm_info->tm_mon + 1,
-                    tm_info->tm_mday, tm_info->tm_hour, tm_info->tm_min,
-                    tm_info->tm_sec, ms.count());
-
-      std::fputs(timestamp, file_);
-      atStartOfLine_ = false;
-    }
-
-    // Write the line
-    std::fputs(line.c_str(), file_);
+  // The line this thread is writing to this stream
+  std::string &pendingLine() {
+    thread_local std::map<const TimestampStreambuf *, std::string> lines;
+    return lines[this];
+  }
 
-    // Check if line ends with newline
-    if (!line.empty() && line.back() == '\n') {
-      atStartOfLine_ = true;
-    }
+  void writeLine(const std::string &line) {
+    auto now = std::chrono::system_clock::now();
+    auto time = std::chrono::system_clock::to_time_t(now);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  now.time_since_epoch()) %
+              1000;
 
+    std::tm tm_info{};
+    localtime_r(&time, &tm_info);
+    char timestamp[64];
+    std::snprintf(timestamp, sizeof(timestamp),
+                  "[%04d-%02d-%02d %02d:%02d:%02d.%03ld] ",
+                  tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday,
+                  tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec,
+                  static_cast<long>(ms.count()));
+
+    std::string entry = timestamp + line;
+    // stdout and stderr append to the same file
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::fwrite(entry.data(), 1, entry.size(), file_);
     std::fflush(file_);
-    return 0;
   }
 
   FILE *file_;
-  char buffer_[1024];
-  bool atStartOfLine_;
+  static std::mutex mutex_;
 };
 
+std::mutex TimestampStreambuf::mutex_;
+
 } // namespace
 
 // Forward declarations
@@ -473,12 +507,15 @@ void printUsage(const char *programName) {
       << "Options:\n"
       << "  -c, --config <path>        Path to config file (default: "
          "./config.json)\n"
-      << "  -d, --device-id <id>       Modbus device ID (default: 1)\n"
+      << "  -d, --device-id <id>       Modbus device ID (default: 1; continuous "
+         "mode polls all enabled devices unless given)\n"
       << "  -p, --pid-file <path>      PID file path (default: "
          "/tmp/modbuslogger.pid)\n"
       << "  -l, --log-file <path>      Log file path (default: "
          "/var/log/modbuslogger/modbuslogger.log)\n"
       << "  -s, --single-run           Run once and exit (for testing)\n"
+      << "  -i, --import <path>        Bulk load a CSV file (device_id,timestamp,"
+         "register_name,value) with COPY and exit\n"
       << "  -v, --verbose              Print register reading information\n"
       << "  -h, --help                 Show this help message\n";
 }
@@ -554,11 +591,6 @@ bool readSingleRegister(ModbusLogger::ModbusClient &modbusClient,
     }
 
     if (success) {
-      if (retryCount > 0) {
-        modbusClient.flushBuffer();
-        std::this_thread::sleep_for(
-            std::chrono::milliseconds(POST_RETRY_DELAY_MS));
-      }
       break;
     }
 
@@ -570,7 +602,7 @@ bool readSingleRegister(ModbusLogger::ModbusClient &modbusClient,
                   << std::endl;
       }
       modbusClient.flushBuffer();
-      std::this_thread::sleep_for(std::chrono::milliseconds(RETRY_DELAY_MS));
+      modbusClient.waitInterFrameDelay();
     }
   }
 
@@ -582,7 +614,7 @@ bool readSingleRegister(ModbusLogger::ModbusClient &modbusClient,
   }
 
   modbusClient.flushBuffer();
-  std::this_thread::sleep_for(std::chrono::milliseconds(READ_DELAY_MS));
+  modbusClient.waitInterFrameDelay();
 
   if (verbose) {
     std::cerr << "  Raw value(s): ";
@@ -597,30 +629,6 @@ bool readSingleRegister(ModbusLogger::ModbusClient &modbusClient,
   return true;
 }
 
-bool ensureDatabaseConnection(
-    ModbusLogger::DatabaseManager &dbManager, int deviceId,
-    const std::vector<ModbusLogger::RegisterDefinition> &registers) {
-  if (dbManager.isConnected()) {
-    return true;
-  }
-
-  std::cerr << "Reconnecting to database..." << std::endl;
-  if (!dbManager.connect()) {
-    std::cerr << "Error: Failed to reconnect to database: "
-              << dbManager.getLastError() << std::endl;
-    return false;
-  }
-
-  // Ensure table exists
-  ModbusLogger::SchemaManager schemaManager(dbManager);
-  if (!schemaManager.ensureTableExists(deviceId, registers)) {
-    std::cerr << "Error: Failed to ensure table exists" << std::endl;
-    return false;
-  }
-
-  return true;
-}
-
 bool ensureModbusConnection(ModbusLogger::ModbusClient &modbusClient) {
   if (modbusClient.isConnected()) {
     return true;
@@ -636,80 +644,159 @@ bool ensureModbusConnection(ModbusLogger::ModbusClient &modbusClient) {
   return true;
 }
 
+// Change a register must exceed to be stored, from its compression settings
+double getTolerance(const ModbusLogger::CompressionConfig &compression,
+                    double reference) {
+  return std::max(compression.absolute,
+                  compression.percent / 100.0 * std::abs(reference));
+}
+
+// Whether an unchanged value must be rewritten. Heartbeats are due once per
+// max-silence interval on a wall-clock grid of that interval rather than
+// relative to each register's last write, so registers sharing an interval
+// come due in the same tick and go out in one batch.
+bool isHeartbeatDue(const ModbusLogger::RegisterState &state, uint16_t id,
+                    std::chrono::steady_clock::time_point now,
+                    std::chrono::system_clock::time_point timestamp) {
+  int64_t silenceMicros =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          state.maxSilences[id])
+          .count();
+  if (silenceMicros <= 0) {
+    return false;
+  }
+  int64_t sinceWriteMicros =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          now - state.lastWriteTimes[id])
+          .count();
+  int64_t nowMicros = ModbusLogger::toEpochMicros(timestamp);
+  return nowMicros / silenceMicros >
+         (nowMicros - sinceWriteMicros) / silenceMicros;
+}
+
+// Queue a value for the next batched write if it changed since the last
+// stored value (or its heartbeat is due). Last values and write times are
+// updated by recordStoredRows when the batch is handed over (and forgotten
+// again for rows the writer drops); swinging-door state is updated here.
 bool storeValueIfChanged(
-    ModbusLogger::DatabaseManager &dbManager, int deviceId,
-    const std::string &registerName, double value,
-    std::map<std::string, double> &lastValues,
-    std::map<std::string, std::chrono::steady_clock::time_point>
-        &lastUpdateTimes,
-    std::chrono::seconds period, const std::string &periodStr,
-    const std::chrono::system_clock::time_point &batchTimestamp) {
+    int deviceId, const ModbusLogger::RegisterDefinition &reg, double value,
+    ModbusLogger::RegisterState &state,
+    const std::chrono::system_clock::time_point &batchTimestamp,
+    std::vector<ModbusLogger::SampleRow> &pendingRows) {
   auto now = std::chrono::steady_clock::now();
-
-  // Check if REPEAT_DATA_PERIOD periods have passed since last update
-  bool forceWrite = false;
-  if (lastUpdateTimes.find(registerName) != lastUpdateTimes.end()) {
-    auto timeSinceLastUpdate = now - lastUpdateTimes[registerName];
-    auto tenPeriods = std::chrono::seconds(period.count() * REPEAT_DATA_PERIOD);
-    if (timeSinceLastUpdate >= tenPeriods) {
-      forceWrite = true;
+  uint16_t id = reg.id;
+  const auto &compression = reg.compression;
+  bool swingingDoor =
+      compression.method == ModbusLogger::CompressionMethod::SwingingDoor;
+  ModbusLogger::SwingingDoor::Point point{
+      ModbusLogger::toEpochMicros(batchTimestamp), value};
+
+  // Write the first value seen and heartbeats of unchanged values
+  bool forceWrite = !state.hasWriteTime(id) ||
+                    isHeartbeatDue(state, id, now, batchTimestamp);
+  // A swinging door needs a stored point to start from
+  forceWrite = forceWrite || (swingingDoor && !state.doors[id].isStarted());
+
+  if (!forceWrite && swingingDoor) {
+    ModbusLogger::SwingingDoor::Point stored;
+    double deviation = getTolerance(compression, state.lastValues[id]);
+    if (!state.doors[id].offer(point, deviation, stored)) {
+      return false; // Still within the corridor
     }
-  } else {
-    // First time seeing this register, force write
-    forceWrite = true;
+    // Store the point that ended the segment, with its own timestamp
+    pendingRows.push_back({deviceId,
+                           ModbusLogger::fromEpochMicros(stored.timeMicros),
+                           reg.name, stored.value, id});
+    return true;
   }
 
   // Check if value changed
-  bool shouldInsert = true;
-  if (!forceWrite && lastValues.find(registerName) != lastValues.end()) {
-    double lastValue = lastValues[registerName];
-    if (std::abs(value - lastValue) < VALUE_EPSILON) {
-      shouldInsert = false;
+  if (!forceWrite && state.hasValue(id)) {
+    double change = std::abs(value - state.lastValues[id]);
+    if (compression.method == ModbusLogger::CompressionMethod::Deadband
+            ? change <= getTolerance(compression, state.lastValues[id])
+            : change < VALUE_EPSILON) {
+      return false; // No change worth storing
     }
   }
 
-  if (!shouldInsert) {
-    return true; // No change, nothing to do
+  // Log period for this register
+  std::cerr << "Storing value for register: " << reg.name
+            << " (period: " << state.periods[id].count() << "s)" << std::endl;
+
+  // A forced write ends the segment early; the held point may still be
+  // needed to keep the segment within the tolerance
+  if (forceWrite && swingingDoor && state.doors[id].isStarted()) {
+    ModbusLogger::SwingingDoor::Point stored;
+    double deviation = getTolerance(compression, state.lastValues[id]);
+    if (state.doors[id].offer(point, deviation, stored)) {
+      pendingRows.push_back({deviceId,
+                             ModbusLogger::fromEpochMicros(stored.timeMicros),
+                             reg.name, stored.value, id});
+    }
   }
 
-  // Insert into database
-  try {
-    pqxx::work txn(dbManager.getConnection());
+  pendingRows.push_back({deviceId, batchTimestamp, reg.name, value, id});
+  if (swingingDoor) {
+    state.doors[id].reset(point);
+  }
+  return true;
+}
 
-    // Convert batch timestamp to PostgreSQL ISO 8601 format
-    auto timeT = std::chrono::system_clock::to_time_t(batchTimestamp);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                  batchTimestamp.time_since_epoch()) %
-              1000;
-    std::tm *tmInfo = std::gmtime(&timeT);
-    char timestampStr[64];
-    std::snprintf(timestampStr, sizeof(timestampStr),
-                  "%04d-%02d-%02d %02d:%02d:%02d.%03ld+00",
-                  tmInfo->tm_year + 1900, tmInfo->tm_mon + 1, tmInfo->tm_mday,
-                  tmInfo->tm_hour, tmInfo->tm_min, tmInfo->tm_sec, ms.count());
-
-    std::ostringstream insertQuery;
-    insertQuery << "INSERT INTO " << quoteIdentifier(TABLE_NAME)
-                << " (device_id, timestamp, register_name, value) VALUES ("
-                << deviceId << ", " << txn.quote(timestampStr)
-                << "::timestamptz, " << txn.quote(registerName) << ", "
-                << txn.quote(value) << ")";
-    txn.exec(insertQuery.str());
-    txn.commit();
-
-    // Log period for this register
-    std::cerr << "Storing value for register: " << registerName
-              << " (period: " << periodStr << ")" << std::endl;
-
-    // Update in-memory value and timestamp
-    lastValues[registerName] = value;
-    lastUpdateTimes[registerName] = now;
+// Record rows as the last stored values for change detection
+void recordStoredRows(const std::vector<ModbusLogger::SampleRow> &rows,
+                      ModbusLogger::RegisterState &state) {
+  auto now = std::chrono::steady_clock::now();
+  for (const auto &row : rows) {
+    state.recordWrite(row.registerId, row.value, now);
+  }
+}
+
+// Write all queued rows in one transaction and, on success, record them as
+// the last stored values
+bool flushPendingRows(ModbusLogger::DatabaseManager &dbManager,
+                      std::vector<ModbusLogger::SampleRow> &pendingRows,
+                      ModbusLogger::RegisterState &state) {
+  if (pendingRows.empty()) {
     return true;
-  } catch (const std::exception &e) {
-    std::cerr << "Error: Failed to insert data for " << registerName << ": "
-              << e.what() << std::endl;
-    return false;
   }
+
+  ModbusLogger::FlushStats stats;
+  bool success = dbManager.writeSamples(pendingRows, stats);
+  if (success) {
+    recordStoredRows(pendingRows, state);
+    std::cerr << "Stored " << stats.rows << " values in "
+              << stats.latency.count() / 1000.0 << " ms" << std::endl;
+  } else {
+    std::cerr << "Error: Failed to store " << pendingRows.size()
+              << " values: " << dbManager.getLastError() << std::endl;
+  }
+
+  pendingRows.clear();
+  return success;
+}
+
+// Register ids of a device by name, for matching rows loaded from the
+// database
+std::map<std::string, uint16_t>
+getRegisterIds(const ModbusLogger::DeviceConfig &deviceConfig) {
+  std::map<std::string, uint16_t> ids;
+  for (const auto &reg : deviceConfig.registers) {
+    ids[reg.name] = reg.id;
+  }
+  return ids;
+}
+
+void logWriterStats(const ModbusLogger::AsyncWriter &writer) {
+  auto stats = writer.getStats();
+  std::cerr << "Writer stats: queue " << stats.queueDepth << "/"
+            << stats.queueCapacity << ", enqueued " << stats.enqueued
+            << ", written " << stats.written << ", dropped " << stats.dropped
+            << ", failed flushes " << stats.failedFlushes << ", spooled "
+            << stats.spooled << ", replayed " << stats.replayed
+            << ", spool pending " << stats.spoolPending << ", rollups "
+            << stats.rollupsWritten << ", tariff totals "
+            << stats.tariffTotalsWritten << std::endl;
 }
 
 int runSingleMode(const ModbusLogger::Config &config, int deviceId,
@@ -736,11 +823,12 @@ int runSingleMode(const ModbusLogger::Config &config, int deviceId,
     return 1;
   }
 
-  // Get enabled registers
+  // Get enabled registers; virtual ones are computed, not read
   std::vector<ModbusLogger::RegisterDefinition> registers;
+  std::vector<ModbusLogger::RegisterDefinition> virtualRegisters;
   for (const auto &reg : deviceConfig->registers) {
     if (reg.enabled) {
-      registers.push_back(reg);
+      (reg.isVirtual ? virtualRegisters : registers).push_back(reg);
     }
   }
 
@@ -758,59 +846,20 @@ int runSingleMode(const ModbusLogger::Config &config, int deviceId,
     return 1;
   }
 
-  // Group registers by type for batching
-  std::map<ModbusLogger::ModbusRegisterType,
-           std::vector<const ModbusLogger::RegisterDefinition *>>
-      typeGroups;
-  for (const auto &reg : registers) {
-    typeGroups[reg.regType].push_back(&reg);
-  }
-
-  // Create batches for each type
+  // Plan the reads and assign registers to them
   std::vector<RegisterBatch> batches;
-  for (auto &[regType, typeRegisters] : typeGroups) {
-    // Sort by adjusted address
-    std::sort(typeRegisters.begin(), typeRegisters.end(),
-              [deviceConfig](const ModbusLogger::RegisterDefinition *a,
-                             const ModbusLogger::RegisterDefinition *b) {
-                uint16_t addrA =
-                    getAdjustedAddress(a->address, deviceConfig->isZero);
-                uint16_t addrB =
-                    getAdjustedAddress(b->address, deviceConfig->isZero);
-                return addrA < addrB;
-              });
-
-    // Create batches for this type
-    for (size_t i = 0; i < typeRegisters.size();) {
-      RegisterBatch batch;
-      batch.regType = regType;
-      batch.startAddress =
-          getAdjustedAddress(typeRegisters[i]->address, deviceConfig->isZero);
-
-      // Add registers to batch while within word limit
-      while (i < typeRegisters.size()) {
-        const auto *reg = typeRegisters[i];
-        uint16_t regAddress =
-            getAdjustedAddress(reg->address, deviceConfig->isZero);
-        uint16_t wordCount = getRegisterWordCount(*reg);
-
-        // Calculate the span needed: from startAddress to end of this register
-        uint16_t endAddress = regAddress + wordCount;
-        uint16_t spanNeeded = endAddress - batch.startAddress;
-
-        if (spanNeeded > MAX_BATCH_WORDS && !batch.registers.empty()) {
-          break;
-        }
-
-        batch.registers.push_back(reg);
-        batch.totalWords = spanNeeded;
-        ++i;
-      }
-
-      if (!batch.registers.empty()) {
-        batches.push_back(batch);
+  for (const auto &range : ModbusLogger::ReadPlanner::planAll(*deviceConfig)) {
+    RegisterBatch batch;
+    batch.regType = range.regType;
+    batch.startAddress = getAdjustedAddress(range.start, deviceConfig->isZero);
+    batch.totalWords = range.count;
+    for (const auto &reg : registers) {
+      if (reg.regType == range.regType && reg.address >= range.start &&
+          reg.address < range.start + range.count) {
+        batch.registers.push_back(&reg);
       }
     }
+    batches.push_back(batch);
   }
 
   // Read all batches and collect results
@@ -860,20 +909,21 @@ int runSingleMode(const ModbusLogger::Config &config, int deviceId,
 
   // Process data
   ModbusLogger::DataProcessor processor;
-  processor.setPreprocessFunction(createPreprocessFunction(deviceId));
+  processor.loadExpressions(deviceConfig->registers);
   std::vector<ModbusLogger::RegisterValue> processedValues =
       processor.processRegisters(registers, allRawValues);
 
   if (verbose) {
     std::cerr << "\nProcessed values:" << std::endl;
     for (const auto &value : processedValues) {
-      std::cerr << "  " << value.name << " (address " << value.address
+      std::cerr << "  " << deviceConfig->registers[value.registerId].name
+                << " (address " << value.address
                 << "): " << value.processedValue << std::endl;
     }
   }
 
   // Connect to database
-  ModbusLogger::DatabaseManager dbManager(config.databaseConnectionString);
+  ModbusLogger::DatabaseManager dbManager(config.database);
   if (!dbManager.connect()) {
     std::cerr << "Error: Failed to connect to database: "
               << dbManager.getLastError() << std::endl;
@@ -881,40 +931,28 @@ int runSingleMode(const ModbusLogger::Config &config, int deviceId,
   }
 
   // Ensure table exists
+  std::vector<ModbusLogger::RegisterDefinition> storedRegisters = registers;
+  storedRegisters.insert(storedRegisters.end(), virtualRegisters.begin(),
+                         virtualRegisters.end());
   ModbusLogger::SchemaManager schemaManager(dbManager);
-  if (!schemaManager.ensureTableExists(deviceId, registers)) {
+  if (!schemaManager.ensureTableExists(deviceId, storedRegisters)) {
     std::cerr << "Error: Failed to ensure table exists" << std::endl;
     dbManager.disconnect();
     return 1;
   }
 
-  // Get last values
-  std::map<std::string, double> lastValues;
-  try {
-    pqxx::work txn(dbManager.getConnection());
-    std::ostringstream lastValueQuery;
-    lastValueQuery << "SELECT DISTINCT ON (register_name) register_name, value "
-                   << "FROM " << quoteIdentifier(TABLE_NAME) << " "
-                   << "WHERE device_id = " << deviceId << " "
-                   << "ORDER BY register_name, timestamp DESC";
-    pqxx::result lastResult = txn.exec(lastValueQuery.str());
-    for (const auto &row : lastResult) {
-      if (!row[1].is_null()) {
-        lastValues[row[0].as<std::string>()] = row[1].as<double>();
-      }
-    }
-  } catch (const std::exception &e) {
-    // Continue if query fails
-  }
-
-  // Initialize timestamp tracking map
-  std::map<std::string, std::chrono::steady_clock::time_point> lastUpdateTimes;
+  // Single mode always writes every value: nothing was written yet by this
+  // process, so no last values are loaded. A period of 1s is only logged.
+  ModbusLogger::RegisterState state(deviceConfig->registers.size());
+  std::fill(state.periods.begin(), state.periods.end(),
+            std::chrono::seconds(1));
 
   // Store changed values
   // Use batch timestamp for all registers (captured when batches were read)
   auto batchTimestampForStorage =
       timestampCaptured ? batchTimestamp : std::chrono::system_clock::now();
 
+  std::vector<ModbusLogger::SampleRow> pendingRows;
   for (size_t i = 0; i < processedValues.size(); ++i) {
     if (processedValues[i].address != registers[i].address) {
       std::cerr << "Error: Register order mismatch" << std::endl;
@@ -922,55 +960,513 @@ int runSingleMode(const ModbusLogger::Config &config, int deviceId,
       return 1;
     }
 
-    // For single mode, always force write (use default period of 1s)
-    auto period = std::chrono::seconds(1);
-    storeValueIfChanged(dbManager, deviceId, processedValues[i].name,
-                        processedValues[i].processedValue, lastValues,
-                        lastUpdateTimes, period, "1s",
-                        batchTimestampForStorage);
+    storeValueIfChanged(deviceId,
+                        deviceConfig->registers[processedValues[i].registerId],
+                        processedValues[i].processedValue, state,
+                        batchTimestampForStorage, pendingRows);
   }
 
+  std::vector<ModbusLogger::VirtualValue> virtualValues;
+  processor.evaluateVirtual(virtualValues);
+  for (const auto &value : virtualValues) {
+    storeValueIfChanged(deviceId, deviceConfig->registers[value.registerId],
+                        value.value, state, batchTimestampForStorage,
+                        pendingRows);
+  }
+
+  // Write all changed values in a single transaction
+  flushPendingRows(dbManager, pendingRows, state);
+
   dbManager.disconnect();
   return 0;
 }
 
-int runContinuousMode(const ModbusLogger::Config &config, int deviceId,
-                      bool verbose, const std::string &pidFilePath,
-                      bool deviceIdExplicit, const std::string &logFilePath) {
-  // Find device configuration
-  const ModbusLogger::DeviceConfig *deviceConfig = nullptr;
-  for (const auto &device : config.devices) {
-    if (device.id == deviceId) {
-      deviceConfig = &device;
+// Poll state of one device in continuous mode
+struct DevicePoller {
+  const ModbusLogger::DeviceConfig *deviceConfig;
+  std::vector<ModbusLogger::RegisterDefinition> registers; // Periods resolved
+  std::vector<ModbusLogger::RangeDefinition> ranges;       // Planned reads
+  std::vector<ModbusLogger::DecodePlan> plans; // Per range
+  RangeReadResult readBuffer;      // Reused across reads
+  std::vector<double> decodedValues; // Reused across reads
+  std::vector<ModbusLogger::VirtualValue> virtualValues; // Reused per tick
+  std::chrono::system_clock::time_point lastReadTime; // Of the latest range
+  ModbusLogger::PeriodicScheduler scheduler;
+  std::unique_ptr<ModbusLogger::ModbusClient> modbusClient;
+  ModbusLogger::DataProcessor processor;
+  ModbusLogger::RegisterState state; // Indexed by register id
+  std::mutex stateMutex;             // Against the snapshot saver
+  bool storeEveryRead = false;       // Wide storage: whole ranges, unchanged too
+  std::vector<ModbusLogger::SampleRow> pendingRows; // Changed during this tick
+  std::unique_ptr<ModbusLogger::RollupAggregator> rollups; // Null if disabled
+  // Null without counter registers
+  std::unique_ptr<ModbusLogger::TariffAccumulator> tariff;
+};
+
+// Sleep in short slices so shutdown is not delayed by long periods
+void sleepUnlessShutdown(std::chrono::milliseconds duration) {
+  auto wakeTime = std::chrono::steady_clock::now() + duration;
+  while (!g_shutdownRequested) {
+    auto now = std::chrono::steady_clock::now();
+    if (now >= wakeTime) {
       break;
     }
+    std::this_thread::sleep_for(
+        std::min<std::chrono::steady_clock::duration>(wakeTime - now,
+                                                      SHUTDOWN_POLL_INTERVAL));
   }
+}
 
-  if (deviceConfig == nullptr) {
-    std::cerr << "Error: Device ID " << deviceId
-              << " not found in configuration" << std::endl;
-    return 1;
+// steady_clock time of a wall-clock time, for state kept across restarts
+std::chrono::steady_clock::time_point
+toSteadyTime(std::chrono::system_clock::time_point time) {
+  return std::chrono::steady_clock::now() -
+         std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+             std::chrono::system_clock::now() - time);
+}
+
+std::chrono::system_clock::time_point
+toSystemTime(std::chrono::steady_clock::time_point time) {
+  return std::chrono::system_clock::now() -
+         std::chrono::duration_cast<std::chrono::system_clock::duration>(
+             std::chrono::steady_clock::now() - time);
+}
+
+// Restore last values and write times from the snapshot of a previous run;
+// returns the number of registers restored
+size_t loadSnapshot(ModbusLogger::StateSnapshot &snapshot,
+                    std::vector<std::unique_ptr<DevicePoller>> &pollers) {
+  std::vector<ModbusLogger::StateSnapshot::Entry> entries;
+  if (!snapshot.load(entries)) {
+    std::cerr << "Warning: Ignoring state snapshot: "
+              << snapshot.getLastError() << std::endl;
+    return 0;
   }
 
-  // If device was explicitly specified via -d, ignore enabled flag
-  // Otherwise, check if device is enabled
-  if (!deviceIdExplicit && !deviceConfig->enabled) {
-    std::cerr << "Error: Device ID " << deviceId << " is disabled" << std::endl;
-    return 1;
+  std::map<int, DevicePoller *> pollersById;
+  std::map<int, std::map<std::string, uint16_t>> registerIdsByDevice;
+  for (const auto &poller : pollers) {
+    pollersById[poller->deviceConfig->id] = poller.get();
+    registerIdsByDevice[poller->deviceConfig->id] =
+        getRegisterIds(*poller->deviceConfig);
+  }
+
+  size_t restored = 0;
+  for (const auto &entry : entries) {
+    auto it = pollersById.find(entry.deviceId);
+    if (it == pollersById.end()) {
+      continue;
+    }
+    const auto &registerIds = registerIdsByDevice[entry.deviceId];
+    auto idIt = registerIds.find(entry.registerName);
+    if (idIt != registerIds.end()) {
+      it->second->state.recordWrite(idIt->second, entry.value,
+                                    toSteadyTime(entry.writeTime));
+      ++restored;
+    }
+  }
+  return restored;
+}
+
+void saveSnapshot(ModbusLogger::StateSnapshot &snapshot,
+                  const std::vector<std::unique_ptr<DevicePoller>> &pollers) {
+  std::vector<ModbusLogger::StateSnapshot::Entry> entries;
+  for (const auto &poller : pollers) {
+    std::lock_guard<std::mutex> lock(poller->stateMutex);
+    const auto &state = poller->state;
+    for (const auto &reg : poller->deviceConfig->registers) {
+      if (state.hasWriteTime(reg.id)) {
+        entries.push_back({poller->deviceConfig->id, reg.name,
+                           state.lastValues[reg.id],
+                           toSystemTime(state.lastWriteTimes[reg.id])});
+      }
+    }
+  }
+
+  if (!snapshot.save(entries)) {
+    std::cerr << "Warning: Failed to save state snapshot: "
+              << snapshot.getLastError() << std::endl;
+  }
+}
+
+// Inter-frame delay each device's pacing has settled on
+void logPacing(const std::vector<std::unique_ptr<DevicePoller>> &pollers) {
+  for (const auto &poller : pollers) {
+    if (poller->modbusClient) {
+      std::cerr << "Device " << poller->deviceConfig->id
+                << ": inter-frame delay "
+                << poller->modbusClient->getInterFrameDelay().count() / 1000.0
+                << " ms" << std::endl;
+    }
+  }
+}
+
+// Fallback for registers the snapshot did not cover: the latest sample of
+// each register within LAST_VALUE_WINDOW, one index probe per register
+void loadLastValues(ModbusLogger::DatabaseManager &dbManager,
+                    std::vector<std::unique_ptr<DevicePoller>> &pollers) {
+  std::map<int, DevicePoller *> pollersById;
+  std::map<int, std::map<std::string, uint16_t>> registerIdsByDevice;
+  std::ostringstream deviceIds;
+  for (const auto &poller : pollers) {
+    bool restored = true;
+    for (const auto &reg : poller->registers) {
+      restored = restored && poller->state.hasWriteTime(reg.id);
+    }
+    if (restored) {
+      continue;
+    }
+
+    if (!pollersById.empty()) {
+      deviceIds << ", ";
+    }
+    pollersById[poller->deviceConfig->id] = poller.get();
+    registerIdsByDevice[poller->deviceConfig->id] =
+        getRegisterIds(*poller->deviceConfig);
+    deviceIds << poller->deviceConfig->id;
+  }
+
+  if (pollersById.empty()) {
+    return;
   }
 
-  // Check if ranges are configured
-  if (deviceConfig->ranges.empty()) {
-    std::cerr << "Error: No ranges configured for device " << deviceId
+  try {
+    pqxx::work txn(dbManager.getConnection());
+    std::ostringstream lastValueQuery;
+    lastValueQuery << "SELECT r.device_id, r.name, s.value, "
+                   << "(EXTRACT(EPOCH FROM s.timestamp) * 1000000)::bigint "
+                   << "FROM " << quoteIdentifier(REGISTERS_TABLE_NAME) << " r "
+                   << "CROSS JOIN LATERAL (SELECT value, timestamp FROM "
+                   << quoteIdentifier(SAMPLES_TABLE_NAME) << " "
+                   << "WHERE register_id = r.register_id "
+                   << "AND timestamp > now() - INTERVAL '" << LAST_VALUE_WINDOW
+                   << "' ORDER BY timestamp DESC LIMIT 1) s "
+                   << "WHERE r.device_id IN (" << deviceIds.str() << ")";
+    pqxx::result lastResult = txn.exec(lastValueQuery.str());
+    for (const auto &row : lastResult) {
+      auto it = pollersById.find(row[0].as<int>());
+      if (it == pollersById.end() || row[2].is_null()) {
+        continue;
+      }
+      const auto &registerIds = registerIdsByDevice[it->first];
+      auto idIt = registerIds.find(row[1].as<std::string>());
+      auto &state = it->second->state;
+      if (idIt != registerIds.end() && !state.hasWriteTime(idIt->second)) {
+        state.recordWrite(
+            idIt->second, row[2].as<double>(),
+            toSteadyTime(ModbusLogger::fromEpochMicros(row[3].as<int64_t>())));
+      }
+    }
+  } catch (const std::exception &e) {
+    // Continue if query fails - start with empty last values
+  }
+}
+
+// Counter reading each register's tariff totals were last booked up to, by
+// device and register id. The last stored sample can be behind it (e.g.
+// with compression), so counting continues from here after a restart.
+std::map<std::pair<int, uint16_t>, double>
+loadCounterReadings(ModbusLogger::DatabaseManager &dbManager,
+                    const std::vector<std::unique_ptr<DevicePoller>> &pollers) {
+  std::map<std::pair<int, uint16_t>, double> readings;
+  std::map<int, std::map<std::string, uint16_t>> registerIdsByDevice;
+  std::ostringstream deviceIds;
+  for (const auto &poller : pollers) {
+    if (!poller->tariff) {
+      continue;
+    }
+    if (!registerIdsByDevice.empty()) {
+      deviceIds << ", ";
+    }
+    registerIdsByDevice[poller->deviceConfig->id] =
+        getRegisterIds(*poller->deviceConfig);
+    deviceIds << poller->deviceConfig->id;
+  }
+
+  if (registerIdsByDevice.empty()) {
+    return readings;
+  }
+
+  try {
+    pqxx::work txn(dbManager.getConnection());
+    std::ostringstream query;
+    query << "SELECT DISTINCT ON (t.register_id) r.device_id, r.name, "
+          << "t.last_value FROM "
+          << quoteIdentifier(TARIFF_TOTALS_TABLE_NAME) << " t "
+          << "JOIN " << quoteIdentifier(REGISTERS_TABLE_NAME)
+          << " r ON r.register_id = t.register_id "
+          << "WHERE r.device_id IN (" << deviceIds.str() << ") "
+          << "AND t.last_value IS NOT NULL "
+          << "ORDER BY t.register_id, t.last_time DESC NULLS LAST, "
+          << "t.day DESC";
+    pqxx::result result = txn.exec(query.str());
+    for (const auto &row : result) {
+      int deviceId = row[0].as<int>();
+      const auto &registerIds = registerIdsByDevice[deviceId];
+      auto idIt = registerIds.find(row[1].as<std::string>());
+      if (idIt != registerIds.end()) {
+        readings[{deviceId, idIt->second}] = row[2].as<double>();
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Warning: Failed to load counter readings: " << e.what()
               << std::endl;
-    return 1;
   }
+  return readings;
+}
 
-  // Get enabled registers for mapping
-  std::vector<ModbusLogger::RegisterDefinition> registers;
-  for (const auto &reg : deviceConfig->registers) {
-    if (reg.enabled) {
-      registers.push_back(reg);
+// Read one range of a device and queue its changed values
+void pollRange(DevicePoller &poller, const ModbusLogger::RangeDefinition &range,
+               bool verbose) {
+  const ModbusLogger::DeviceConfig *deviceConfig = poller.deviceConfig;
+  size_t rangeIndex = &range - poller.ranges.data();
+
+  RangeReadResult &rangeResult = poller.readBuffer;
+  if (!readRange(*poller.modbusClient, range, range.regType, deviceConfig,
+                 verbose, rangeResult) ||
+      !rangeResult.success) {
+    // Range stays due and is retried on the next tick
+    return;
+  }
+
+  if (rangeResult.values.size() < range.count) {
+    std::cerr << "Warning: Short response for range starting at "
+              << range.start << std::endl;
+    return;
+  }
+
+  // Capture timestamp when range is successfully read
+  auto rangeTimestamp = std::chrono::system_clock::now();
+  poller.lastReadTime = rangeTimestamp;
+
+  // Decode all registers of the range with its compiled plan
+  const ModbusLogger::DecodePlan &plan = poller.plans[rangeIndex];
+  poller.processor.decode(plan, rangeResult.values, poller.decodedValues);
+
+  // Use range timestamp for all registers from this range. The writer
+  // thread may update the state concurrently.
+  std::lock_guard<std::mutex> lock(poller.stateMutex);
+  for (size_t i = 0; i < plan.steps.size(); ++i) {
+    const auto &reg = poller.registers[plan.steps[i].registerIndex];
+    if (poller.rollups) {
+      poller.rollups->add(reg.id, poller.decodedValues[i], rangeTimestamp);
+    }
+    if (poller.tariff) {
+      poller.tariff->add(reg.id, poller.decodedValues[i], rangeTimestamp);
+    }
+    if (poller.storeEveryRead) {
+      // The range becomes one row of the device table
+      poller.pendingRows.push_back({deviceConfig->id, rangeTimestamp, reg.name,
+                                    poller.decodedValues[i], reg.id});
+      continue;
+    }
+    storeValueIfChanged(deviceConfig->id, reg, poller.decodedValues[i],
+                        poller.state, rangeTimestamp, poller.pendingRows);
+  }
+
+  // Mark range as read
+  poller.scheduler.markRangeRead(range);
+}
+
+// Rows the writer did not get into the database or spool: their registers
+// are written again with the next value read
+void forgetDroppedRows(const std::vector<ModbusLogger::SampleRow> &rows,
+                       const std::vector<DevicePoller *> &pollers) {
+  for (DevicePoller *poller : pollers) {
+    std::lock_guard<std::mutex> lock(poller->stateMutex);
+    for (const auto &row : rows) {
+      if (row.deviceId == poller->deviceConfig->id &&
+          row.registerId < poller->state.size()) {
+        poller->state.forgetWrite(row.registerId);
+      }
+    }
+  }
+}
+
+// Compute the virtual registers whose inputs were read during this tick and
+// queue them like read values, at the time of the latest read
+void storeVirtualValues(DevicePoller &poller) {
+  poller.virtualValues.clear();
+  poller.processor.evaluateVirtual(poller.virtualValues);
+  std::lock_guard<std::mutex> lock(poller.stateMutex);
+  for (const auto &value : poller.virtualValues) {
+    const auto &reg = poller.deviceConfig->registers[value.registerId];
+    if (poller.rollups) {
+      poller.rollups->add(reg.id, value.value, poller.lastReadTime);
+    }
+    if (poller.tariff) {
+      poller.tariff->add(reg.id, value.value, poller.lastReadTime);
+    }
+    if (poller.storeEveryRead) {
+      poller.pendingRows.push_back({poller.deviceConfig->id,
+                                    poller.lastReadTime, reg.name, value.value,
+                                    reg.id});
+      continue;
+    }
+    storeValueIfChanged(poller.deviceConfig->id, reg, value.value,
+                        poller.state, poller.lastReadTime, poller.pendingRows);
+  }
+}
+
+// I/O loop of one serial port. All its devices share one bus connection and
+// their due ranges are read in deadline order.
+void runPortLoop(const std::vector<DevicePoller *> &pollers,
+                 ModbusLogger::AsyncWriter &writer, bool verbose) {
+  struct DueRead {
+    std::chrono::steady_clock::time_point deadline;
+    DevicePoller *poller;
+    const ModbusLogger::RangeDefinition *range;
+  };
+
+  std::vector<DueRead> dueReads;
+  std::vector<ModbusLogger::SampleRow> tickRows;
+  std::vector<ModbusLogger::RollupRow> rollupRows;
+  std::vector<ModbusLogger::TariffRow> tariffRows;
+  auto reconnectAfter = std::chrono::steady_clock::time_point::min();
+  auto lastTariffFlush = std::chrono::steady_clock::now();
+
+  while (!g_shutdownRequested) {
+    // Get ranges that need reading on any device of this port
+    dueReads.clear();
+    for (DevicePoller *poller : pollers) {
+      for (const auto *range : poller->scheduler.getRangesToRead()) {
+        dueReads.push_back(
+            {poller->scheduler.getNextReadTime(*range), poller, range});
+      }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!dueReads.empty() && now >= reconnectAfter) {
+      // Ensure connection (shared by every device on the port)
+      if (!ensureModbusConnection(*pollers.front()->modbusClient)) {
+        reconnectAfter = now + MODBUS_RECONNECT_DELAY;
+      } else {
+        // Most overdue first, whichever device it belongs to
+        std::stable_sort(dueReads.begin(), dueReads.end(),
+                         [](const DueRead &a, const DueRead &b) {
+                           return a.deadline < b.deadline;
+                         });
+        for (const auto &dueRead : dueReads) {
+          if (g_shutdownRequested) {
+            break;
+          }
+          pollRange(*dueRead.poller, *dueRead.range, verbose);
+        }
+
+        // Hand all values changed during this tick to the writer as one batch
+        for (DevicePoller *poller : pollers) {
+          storeVirtualValues(*poller);
+          {
+            std::lock_guard<std::mutex> lock(poller->stateMutex);
+            recordStoredRows(poller->pendingRows, poller->state);
+          }
+          std::move(poller->pendingRows.begin(), poller->pendingRows.end(),
+                    std::back_inserter(tickRows));
+          poller->pendingRows.clear();
+        }
+        writer.submit(tickRows);
+        // Left with the rows the full queue did not take
+        forgetDroppedRows(tickRows, pollers);
+        tickRows.clear();
+      }
+    }
+
+    // Buckets that ended, also while the bus is down
+    auto wallNow = std::chrono::system_clock::now();
+    for (DevicePoller *poller : pollers) {
+      if (poller->rollups) {
+        poller->rollups->collect(wallNow, rollupRows);
+      }
+    }
+    writer.submitRollups(rollupRows);
+
+    if (std::chrono::steady_clock::now() - lastTariffFlush >=
+        TARIFF_FLUSH_INTERVAL) {
+      for (DevicePoller *poller : pollers) {
+        if (poller->tariff) {
+          poller->tariff->collect(tariffRows);
+        }
+      }
+      writer.submitTariffTotals(tariffRows);
+      lastTariffFlush = std::chrono::steady_clock::now();
+    }
+
+    // Sleep until next read is needed on any device of this port
+    auto sleepTime = pollers.front()->scheduler.getTimeUntilNextRead();
+    for (const DevicePoller *poller : pollers) {
+      sleepTime = std::min(sleepTime, poller->scheduler.getTimeUntilNextRead());
+    }
+    sleepUnlessShutdown(sleepTime);
+  }
+
+  pollers.front()->modbusClient->disconnect();
+}
+
+int runContinuousMode(const ModbusLogger::Config &config, int deviceId,
+                      bool verbose, const std::string &pidFilePath,
+                      bool deviceIdExplicit, const std::string &logFilePath) {
+  // Poll the device given with -d (even if disabled), otherwise every
+  // enabled device
+  std::vector<const ModbusLogger::DeviceConfig *> devices;
+  if (deviceIdExplicit) {
+    for (const auto &device : config.devices) {
+      if (device.id == deviceId) {
+        devices.push_back(&device);
+        break;
+      }
+    }
+
+    if (devices.empty()) {
+      std::cerr << "Error: Device ID " << deviceId
+                << " not found in configuration" << std::endl;
+      return 1;
+    }
+
+    if (ModbusLogger::ReadPlanner::planScheduled(*devices.front()).empty()) {
+      std::cerr << "Error: No registers with a period configured for device "
+                << deviceId << std::endl;
+      return 1;
+    }
+  } else {
+    std::map<int, const ModbusLogger::DeviceConfig *> devicesById;
+    for (const auto &device : config.devices) {
+      if (!device.enabled) {
+        continue;
+      }
+      if (ModbusLogger::ReadPlanner::planScheduled(device).empty()) {
+        std::cerr << "Warning: No registers with a period configured for "
+                  << "device " << device.id << ", skipping it" << std::endl;
+        continue;
+      }
+      if (!devicesById.emplace(device.id, &device).second) {
+        std::cerr << "Error: Device ID " << device.id
+                  << " is configured more than once" << std::endl;
+        return 1;
+      }
+      devices.push_back(&device);
+    }
+
+    if (devices.empty()) {
+      std::cerr << "Error: No enabled devices with registers to poll in "
+                << "configuration" << std::endl;
+      return 1;
+    }
+  }
+
+  // Devices sharing a serial port share its line settings
+  std::map<std::string, const ModbusLogger::ConnectionParams *> portSettings;
+  for (const auto *device : devices) {
+    const auto &connection = device->connection;
+    auto inserted = portSettings.emplace(connection.port, &connection);
+    const auto *settings = inserted.first->second;
+    if (settings->baudRate != connection.baudRate ||
+        settings->parity != connection.parity ||
+        settings->dataBits != connection.dataBits ||
+        settings->stopBits != connection.stopBits) {
+      std::cerr << "Error: Device " << device->id
+                << " uses different line settings than other devices on "
+                << connection.port << std::endl;
+      return 1;
     }
   }
 
@@ -990,164 +1486,311 @@ int runContinuousMode(const ModbusLogger::Config &config, int deviceId,
   // Setup signal handlers
   daemonManager.setupSignalHandlers(shutdownHandler);
 
-  // Initialize scheduler with ranges
-  ModbusLogger::PeriodicScheduler scheduler;
-  for (const auto &range : deviceConfig->ranges) {
-    scheduler.addRange(range);
-  }
+  // One bus (libmodbus context) per serial port
+  std::map<std::string, std::shared_ptr<ModbusLogger::ModbusBus>> buses;
+  std::vector<std::unique_ptr<DevicePoller>> pollers;
+  for (const auto *device : devices) {
+    auto poller = std::make_unique<DevicePoller>();
+    poller->deviceConfig = device;
+    poller->storeEveryRead =
+        config.database.storageMode == ModbusLogger::StorageMode::Wide;
+
+    // Get enabled registers for mapping
+    poller->state.resize(device->registers.size());
+    for (const auto &reg : device->registers) {
+      if (reg.enabled) {
+        poller->registers.push_back(reg);
+        poller->registers.back().period =
+            ModbusLogger::ReadPlanner::resolvePeriod(*device, reg);
+        if (!poller->registers.back().period.empty()) {
+          poller->state.periods[reg.id] =
+              ModbusLogger::PeriodParser::parsePeriod(
+                  poller->registers.back().period);
+        }
+        if (reg.maxSilence.empty()) {
+          poller->state.maxSilences[reg.id] =
+              poller->state.periods[reg.id] * DEFAULT_SILENCE_PERIODS;
+        } else if (reg.maxSilence != "none") {
+          poller->state.maxSilences[reg.id] =
+              ModbusLogger::PeriodParser::parsePeriod(reg.maxSilence);
+        }
+      }
+    }
 
-  if (!scheduler.hasRanges()) {
-    std::cerr << "Error: No ranges to schedule" << std::endl;
-    return 1;
+    // Expressions were checked when the config was loaded
+    poller->processor.loadExpressions(device->registers);
+
+    // Plan the reads; configured ranges only supply default periods
+    poller->ranges = ModbusLogger::ReadPlanner::planScheduled(*device);
+    for (const auto &range : poller->ranges) {
+      std::cerr << "Device " << device->id << ": reading " << range.count
+                << " from " << range.start << " every " << range.period
+                << std::endl;
+      poller->scheduler.addRange(range);
+      poller->plans.push_back(
+          poller->processor.compilePlan(range, poller->registers));
+    }
+
+    // Connect to Modbus; a port that cannot be opened yet is retried by its
+    // port loop
+    auto &bus = buses[device->connection.port];
+    if (!bus) {
+      bus = std::make_shared<ModbusLogger::ModbusBus>(device->connection);
+    }
+    poller->modbusClient =
+        std::make_unique<ModbusLogger::ModbusClient>(bus, device->id);
+    if (!poller->modbusClient->isConnected() &&
+        !poller->modbusClient->connect()) {
+      std::cerr << "Error: Failed to connect to Modbus device " << device->id
+                << ": " << poller->modbusClient->getLastError() << std::endl;
+    }
+
+    if (!config.database.rollups.empty()) {
+      poller->rollups = std::make_unique<ModbusLogger::RollupAggregator>(
+          device->id, device->registers, config.database.rollups);
+    }
+    poller->tariff = std::make_unique<ModbusLogger::TariffAccumulator>(
+        device->id, device->registers, config.tariff);
+    if (!poller->tariff->hasCounters()) {
+      poller->tariff.reset();
+    }
+
+    pollers.push_back(std::move(poller));
   }
 
-  // Connect to Modbus
-  ModbusLogger::ModbusClient modbusClient(deviceConfig->connection, deviceId);
-  if (!modbusClient.connect()) {
-    std::cerr << "Error: Failed to connect to Modbus device: "
-              << modbusClient.getLastError() << std::endl;
-    return 1;
+  // Warm-start change detection from the snapshot of the previous run
+  ModbusLogger::StateSnapshot snapshot(config.stateFile);
+  if (!config.stateFile.empty()) {
+    size_t restored = loadSnapshot(snapshot, pollers);
+    std::cerr << "Restored state of " << restored << " register(s) from "
+              << config.stateFile << std::endl;
   }
 
   // Connect to database
-  ModbusLogger::DatabaseManager dbManager(config.databaseConnectionString);
+  // An unreachable database is not fatal: the writer spools samples and
+  // retries, so polling starts with empty last values
+  ModbusLogger::DatabaseManager dbManager(config.database);
+  std::map<std::pair<int, uint16_t>, double> counterReadings;
   if (!dbManager.connect()) {
-    std::cerr << "Error: Failed to connect to database: "
+    std::cerr << "Warning: Database unavailable at startup, values will be "
+                 "spooled until it is reachable: "
               << dbManager.getLastError() << std::endl;
-    modbusClient.disconnect();
-    return 1;
-  }
+  } else {
+    // Ensure table exists
+    ModbusLogger::SchemaManager schemaManager(dbManager);
+    for (const auto &poller : pollers) {
+      if (!schemaManager.ensureTableExists(poller->deviceConfig->id,
+                                           poller->registers)) {
+        std::cerr << "Error: Failed to ensure table exists" << std::endl;
+        dbManager.disconnect();
+        return 1;
+      }
+    }
 
-  // Ensure table exists
-  ModbusLogger::SchemaManager schemaManager(dbManager);
-  if (!schemaManager.ensureTableExists(deviceId, registers)) {
-    std::cerr << "Error: Failed to ensure table exists" << std::endl;
-    dbManager.disconnect();
-    modbusClient.disconnect();
-    return 1;
+    // Initialize last values the snapshot did not cover from database
+    loadLastValues(dbManager, pollers);
+    counterReadings = loadCounterReadings(dbManager, pollers);
   }
 
-  // Initialize last values from database
-  std::map<std::string, double> lastValues;
-  try {
-    pqxx::work txn(dbManager.getConnection());
-    std::ostringstream lastValueQuery;
-    lastValueQuery << "SELECT DISTINCT ON (register_name) register_name, value "
-                   << "FROM " << quoteIdentifier(TABLE_NAME) << " "
-                   << "WHERE device_id = " << deviceId << " "
-                   << "ORDER BY register_name, timestamp DESC";
-    pqxx::result lastResult = txn.exec(lastValueQuery.str());
-    for (const auto &row : lastResult) {
-      if (!row[1].is_null()) {
-        lastValues[row[0].as<std::string>()] = row[1].as<double>();
+  // Counter increases continue from the readings last booked, or else from
+  // the last stored values
+  for (const auto &poller : pollers) {
+    if (!poller->tariff) {
+      continue;
+    }
+    for (const auto &reg : poller->registers) {
+      auto it = counterReadings.find({poller->deviceConfig->id, reg.id});
+      if (it != counterReadings.end()) {
+        poller->tariff->setPrevious(reg.id, it->second);
+      } else if (poller->state.hasValue(reg.id)) {
+        poller->tariff->setPrevious(reg.id, poller->state.lastValues[reg.id]);
       }
     }
-  } catch (const std::exception &e) {
-    // Continue if query fails - start with empty last values
   }
 
-  // Initialize timestamp tracking map
-  std::map<std::string, std::chrono::steady_clock::time_point> lastUpdateTimes;
+  // From here on the writer thread owns database access
+  dbManager.disconnect();
+  // Declared before the writer, whose thread uses it until stopped
+  std::vector<DevicePoller *> allPollers;
+  for (const auto &poller : pollers) {
+    allPollers.push_back(poller.get());
+  }
+  ModbusLogger::AsyncWriter writer(config.database, config.writer);
+  for (const auto &poller : pollers) {
+    writer.addDevice(poller->deviceConfig->id, poller->registers);
+  }
+  writer.setDropHandler(
+      [&allPollers](const std::vector<ModbusLogger::SampleRow> &rows) {
+        forgetDroppedRows(rows, allPollers);
+      });
+  writer.start();
 
-  // Main loop
-  ModbusLogger::DataProcessor processor;
-  processor.setPreprocessFunction(createPreprocessFunction(deviceId));
+  // One I/O thread per serial port, all feeding the same writer
+  std::map<std::string, std::vector<DevicePoller *>> pollersByPort;
+  for (const auto &poller : pollers) {
+    pollersByPort[poller->deviceConfig->connection.port].push_back(
+        poller.get());
+  }
+
+  std::cerr << "Polling " << pollers.size() << " device(s) on "
+            << pollersByPort.size() << " port(s)" << std::endl;
+
+  std::vector<std::thread> portThreads;
+  for (const auto &entry : pollersByPort) {
+    portThreads.emplace_back(runPortLoop, std::cref(entry.second),
+                             std::ref(writer), verbose);
+  }
 
+  auto lastStatsLog = std::chrono::steady_clock::now();
   while (!g_shutdownRequested) {
-    // Get ranges that need reading
-    auto rangesToRead = scheduler.getRangesToRead();
-
-    if (rangesToRead.empty()) {
-      // Sleep until next read is needed
-      auto sleepTime = scheduler.getTimeUntilNextRead();
-      if (sleepTime.count() > 0) {
-        std::this_thread::sleep_for(sleepTime);
-      } else {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    sleepUnlessShutdown(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            STATS_LOG_INTERVAL - (std::chrono::steady_clock::now() -
+                                  lastStatsLog)));
+    if (std::chrono::steady_clock::now() - lastStatsLog >=
+        STATS_LOG_INTERVAL) {
+      logWriterStats(writer);
+      logPacing(pollers);
+      if (!config.stateFile.empty()) {
+        saveSnapshot(snapshot, pollers);
       }
-      continue;
+      lastStatsLog = std::chrono::steady_clock::now();
     }
+  }
 
-    // Ensure connections
-    if (!ensureModbusConnection(modbusClient)) {
-      std::this_thread::sleep_for(std::chrono::seconds(5));
-      continue;
-    }
+  for (auto &thread : portThreads) {
+    thread.join();
+  }
 
-    if (!ensureDatabaseConnection(dbManager, deviceId, registers)) {
-      std::this_thread::sleep_for(std::chrono::seconds(5));
-      continue;
+  // End open swinging-door segments with their held points, so the stored
+  // points still interpolate within the tolerance
+  std::vector<ModbusLogger::SampleRow> heldRows;
+  for (const auto &poller : pollers) {
+    std::lock_guard<std::mutex> lock(poller->stateMutex);
+    for (const auto &reg : poller->deviceConfig->registers) {
+      ModbusLogger::SwingingDoor::Point held;
+      if (poller->state.doors[reg.id].takeHeld(held)) {
+        poller->pendingRows.push_back(
+            {poller->deviceConfig->id,
+             ModbusLogger::fromEpochMicros(held.timeMicros), reg.name,
+             held.value, reg.id});
+      }
     }
+    recordStoredRows(poller->pendingRows, poller->state);
+    std::move(poller->pendingRows.begin(), poller->pendingRows.end(),
+              std::back_inserter(heldRows));
+    poller->pendingRows.clear();
+  }
+  writer.submit(heldRows);
+  forgetDroppedRows(heldRows, allPollers);
+
+  // Open buckets too; the next run merges into the same rows
+  std::vector<ModbusLogger::RollupRow> rollupRows;
+  for (const auto &poller : pollers) {
+    if (poller->rollups) {
+      poller->rollups->collectAll(rollupRows);
+    }
+  }
+  writer.submitRollups(rollupRows);
+  std::vector<ModbusLogger::TariffRow> tariffRows;
+  for (const auto &poller : pollers) {
+    if (poller->tariff) {
+      poller->tariff->collect(tariffRows);
+    }
+  }
+  writer.submitTariffTotals(tariffRows);
 
-    // Process each range
-    for (const auto *range : rangesToRead) {
-      RangeReadResult rangeResult;
-      if (!readRange(modbusClient, *range, range->regType, deviceConfig,
-                     verbose, rangeResult)) {
-        // Continue to next range on error
-        continue;
-      }
+  writer.stop();
+  logWriterStats(writer);
+  logPacing(pollers);
 
-      if (!rangeResult.success) {
-        continue;
-      }
+  // After the writer reported what it dropped
+  if (!config.stateFile.empty()) {
+    saveSnapshot(snapshot, pollers);
+  }
+  return 0;
+}
 
-      // Capture timestamp when range is successfully read
-      auto rangeTimestamp = std::chrono::system_clock::now();
-
-      // Find registers that fall within this range
-      uint16_t rangeEnd = range->start + range->count;
-      for (const auto &reg : registers) {
-        if (reg.address >= range->start && reg.address < rangeEnd) {
-          // Calculate offset within the range
-          uint16_t offset = reg.address - range->start;
-          uint16_t wordCount = getRegisterWordCount(reg);
-
-          if (offset + wordCount > rangeResult.values.size()) {
-            std::cerr << "Warning: Register at address " << reg.address
-                      << " extends beyond range response" << std::endl;
-            continue;
-          }
+int runImportMode(const ModbusLogger::Config &config,
+                  const std::string &importPath) {
+  std::ifstream file(importPath);
+  if (!file.is_open()) {
+    std::cerr << "Error: Cannot open import file: " << importPath << std::endl;
+    return 1;
+  }
 
-          // Extract values for this register
-          std::vector<uint16_t> regValues(rangeResult.values.begin() + offset,
-                                          rangeResult.values.begin() + offset +
-                                              wordCount);
+  // Connect to database
+  ModbusLogger::DatabaseManager dbManager(config.database);
+  if (!dbManager.connect()) {
+    std::cerr << "Error: Failed to connect to database: "
+              << dbManager.getLastError() << std::endl;
+    return 1;
+  }
 
-          // Process value
-          std::vector<ModbusLogger::RegisterDefinition> singleReg;
-          singleReg.push_back(reg);
-          auto processedValues =
-              processor.processRegisters(singleReg, regValues);
+  // Ensure table exists
+  ModbusLogger::SchemaManager schemaManager(dbManager);
+  if (!schemaManager.ensureTableExists(0, {})) {
+    std::cerr << "Error: Failed to ensure table exists" << std::endl;
+    dbManager.disconnect();
+    return 1;
+  }
 
-          if (processedValues.empty()) {
-            continue;
-          }
+  std::vector<ModbusLogger::SampleRow> rows;
+  rows.reserve(IMPORT_CHUNK_ROWS);
+  size_t totalRows = 0;
+  size_t skippedRows = 0;
+  size_t lineNumber = 0;
+  std::string line;
 
-          // Store if changed (use period from range)
-          // Use range timestamp for all registers from this range
-          auto period = ModbusLogger::PeriodParser::parsePeriod(range->period);
-          storeValueIfChanged(dbManager, deviceId, processedValues[0].name,
-                              processedValues[0].processedValue, lastValues,
-                              lastUpdateTimes, period, range->period,
-                              rangeTimestamp);
-        }
-      }
+  auto flushChunk = [&]() {
+    ModbusLogger::FlushStats stats;
+    if (!dbManager.copySamples(rows, stats)) {
+      return false;
+    }
+    totalRows += stats.rows;
+    std::cerr << "Imported " << stats.rows << " rows in "
+              << stats.latency.count() / 1000.0 << " ms (total: " << totalRows
+              << ")" << std::endl;
+    rows.clear();
+    return true;
+  };
 
-      // Mark range as read
-      scheduler.markRangeRead(*range);
+  while (std::getline(file, line)) {
+    ++lineNumber;
+    if (line.empty() || (lineNumber == 1 && line.rfind("device_id", 0) == 0)) {
+      continue; // Skip blank lines and header
     }
 
-    // Sleep until next read is needed
-    auto sleepTime = scheduler.getTimeUntilNextRead();
-    if (sleepTime.count() > 0) {
-      std::this_thread::sleep_for(sleepTime);
-    } else {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::vector<std::string> fields = splitCsvLine(line);
+    ModbusLogger::SampleRow row;
+    try {
+      if (fields.size() != 4 || !parseUtcTimestamp(fields[1], row.timestamp)) {
+        throw std::invalid_argument("unexpected format");
+      }
+      row.deviceId = std::stoi(fields[0]);
+      row.registerName = fields[2];
+      row.value = std::stod(fields[3]);
+    } catch (const std::exception &e) {
+      std::cerr << "Warning: Skipping line " << lineNumber << " of "
+                << importPath << ": " << e.what() << std::endl;
+      ++skippedRows;
+      continue;
+    }
+
+    rows.push_back(std::move(row));
+    if (rows.size() >= IMPORT_CHUNK_ROWS && !flushChunk()) {
+      dbManager.disconnect();
+      return 1;
     }
   }
 
-  modbusClient.disconnect();
+  if (!rows.empty() && !flushChunk()) {
+    dbManager.disconnect();
+    return 1;
+  }
+
+  std::cerr << "Import finished: " << totalRows << " rows loaded, "
+            << skippedRows << " skipped" << std::endl;
   dbManager.disconnect();
   return 0;
 }
@@ -1251,6 +1894,7 @@ int main(int argc, char *argv[]) {
   int deviceId = DEFAULT_DEVICE_ID;
   std::string pidFilePath = DEFAULT_PID_FILE;
   std::string logFilePath = DEFAULT_LOG_FILE;
+  std::string importPath;
   bool singleRun = false;
   bool verbose = false;
   bool deviceIdExplicit = false;
@@ -1262,13 +1906,14 @@ int main(int argc, char *argv[]) {
       {"pid-file", required_argument, nullptr, 'p'},
       {"log-file", required_argument, nullptr, 'l'},
       {"single-run", no_argument, nullptr, 's'},
+      {"import", required_argument, nullptr, 'i'},
       {"verbose", no_argument, nullptr, 'v'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, 0, nullptr, 0}};
 
   int optionIndex = 0;
   int c;
-  while ((c = getopt_long(argc, argv, "c:d:p:l:svh", longOptions,
+  while ((c = getopt_long(argc, argv, "c:d:p:l:si:vh", longOptions,
                           &optionIndex)) != -1) {
     switch (c) {
     case 'c':
@@ -1287,6 +1932,9 @@ int main(int argc, char *argv[]) {
     case 's':
       singleRun = true;
       break;
+    case 'i':
+      importPath = optarg;
+      break;
     case 'v':
       verbose = true;
       break;
@@ -1304,7 +1952,10 @@ int main(int argc, char *argv[]) {
     // Parse configuration
     ModbusLogger::Config config = ModbusLogger::ConfigParser::parse(configPath);
 
-    if (singleRun) {
+    if (!importPath.empty()) {
+      // Bulk import runs in the foreground and logs to the console
+      result = runImportMode(config, importPath);
+    } else if (singleRun) {
       // Redirect output to log file for single-run mode (no daemonization)
       if (!redirectOutputToLogFile(logFilePath)) {
         return 1;
@@ -0,0 +1,124 @@
+#include "ModbusBus.h"
+#include <modbus/modbus-rtu.h>
+#include <iostream>
+#include <cerrno>
+
+namespace ModbusLogger {
+
+ModbusBus::ModbusBus(const ConnectionParams& connection)
+    : connectionParams(connection)
+    , ctx(nullptr)
+    , connected(false)
+    , currentSlave(-1)
+{
+}
+
+ModbusBus::~ModbusBus() {
+    disconnect();
+}
+
+bool ModbusBus::connect() {
+    if (connected) {
+        return true;
+    }
+
+    ctx = modbus_new_rtu(
+        connectionParams.port.c_str(),
+        connectionParams.baudRate,
+        connectionParams.parity,
+        connectionParams.dataBits,
+        connectionParams.stopBits
+    );
+
+    if (ctx == nullptr) {
+        lastError = "Failed to create Modbus RTU context";
+        std::cerr << "Error: " << lastError << std::endl;
+        return false;
+    }
+
+    // Set timeouts for RTU communication (devices may override them per
+    // request)
+    // Response timeout: time to wait for response
+    // Byte timeout: time to wait between bytes
+    setTimeouts(std::chrono::milliseconds(connectionParams.responseTimeoutMs),
+                std::chrono::milliseconds(connectionParams.byteTimeoutMs));
+
+    if (modbus_connect(ctx) != 0) {
+        lastError = "Failed to connect to Modbus port " + connectionParams.port + ": " + std::string(modbus_strerror(errno));
+        std::cerr << "Error: " << lastError << std::endl;
+        modbus_free(ctx);
+        ctx = nullptr;
+        return false;
+    }
+
+    connected = true;
+    currentSlave = -1;
+    return true;
+}
+
+void ModbusBus::disconnect() {
+    if (ctx != nullptr) {
+        if (connected) {
+            modbus_close(ctx);
+        }
+        modbus_free(ctx);
+        ctx = nullptr;
+        connected = false;
+        currentSlave = -1;
+    }
+}
+
+bool ModbusBus::isConnected() const {
+    return connected;
+}
+
+bool ModbusBus::selectSlave(int slaveId) {
+    if (!connected || ctx == nullptr) {
+        lastError = "Not connected to Modbus port " + connectionParams.port;
+        return false;
+    }
+
+    if (slaveId == currentSlave) {
+        return true;
+    }
+
+    if (modbus_set_slave(ctx, slaveId) != 0) {
+        lastError = "Failed to set Modbus slave ID: " + std::string(modbus_strerror(errno));
+        return false;
+    }
+
+    currentSlave = slaveId;
+    return true;
+}
+
+void ModbusBus::setTimeouts(std::chrono::microseconds responseTimeout,
+                            std::chrono::microseconds byteTimeout) {
+    if (ctx == nullptr) {
+        return;
+    }
+    modbus_set_response_timeout(ctx, responseTimeout.count() / 1000000,
+                                responseTimeout.count() % 1000000);
+    modbus_set_byte_timeout(ctx, byteTimeout.count() / 1000000,
+                            byteTimeout.count() % 1000000);
+}
+
+void ModbusBus::flush() {
+    if (ctx != nullptr && connected) {
+        // Flush any remaining data in the serial buffer
+        modbus_flush(ctx);
+    }
+}
+
+modbus_t* ModbusBus::getContext() const {
+    return ctx;
+}
+
+const ConnectionParams& ModbusBus::getConnectionParams() const {
+    return connectionParams;
+}
+
+std::string ModbusBus::getLastError() const {
+    return lastError;
+}
+
+} // namespace ModbusLogger
@@ -0,0 +1,49 @@
+#ifndef MODBUSBUS_H
+#define MODBUSBUS_H
+
+#include "Types.h"
+#include <chrono>
+#include <modbus/modbus.h>
+#include <string>
+
+namespace ModbusLogger {
+
+// One serial line and its libmodbus RTU context. All devices on the port
+// share it and the slave address is switched per request, so the port is
+// opened once. Not thread-safe: a bus is driven by a single thread.
+class ModbusBus {
+public:
+  explicit ModbusBus(const ConnectionParams &connection);
+  ~ModbusBus();
+
+  ModbusBus(const ModbusBus &) = delete;
+  ModbusBus &operator=(const ModbusBus &) = delete;
+
+  bool connect();
+  void disconnect();
+  bool isConnected() const;
+
+  // Address the following requests to slaveId
+  bool selectSlave(int slaveId);
+
+  // Timeouts for the following requests
+  void setTimeouts(std::chrono::microseconds responseTimeout,
+                   std::chrono::microseconds byteTimeout);
+
+  void flush();
+
+  modbus_t *getContext() const;
+  const ConnectionParams &getConnectionParams() const;
+  std::string getLastError() const;
+
+private:
+  ConnectionParams connectionParams;
+  modbus_t *ctx;
+  bool connected;
+  int currentSlave; // -1 until a slave is selected
+  std::string lastError;
+};
+
+} // namespace ModbusLogger
+
+#endif // MODBUSBUS_H
@@ -1,87 +1,84 @@
 #include "ModbusClient.h"
-#include <modbus/modbus-rtu.h>
 #include <iostream>
 #include <cstring>
 #include <cerrno>
+#include <thread>
+#include <utility>
 
 namespace ModbusLogger {
 
 ModbusClient::ModbusClient(const ConnectionParams& connection, int deviceId)
-    : connectionParams(connection)
+    : bus(std::make_shared<ModbusBus>(connection))
     , deviceId(deviceId)
-    , ctx(nullptr)
-    , connected(false)
+    , pacing(connection, deviceId)
+    , timeoutTuner(connection, deviceId)
+{
+}
+
+ModbusClient::ModbusClient(std::shared_ptr<ModbusBus> bus, int deviceId)
+    : bus(std::move(bus))
+    , deviceId(deviceId)
+    , pacing(this->bus->getConnectionParams(), deviceId)
+    , timeoutTuner(this->bus->getConnectionParams(), deviceId)
 {
 }
 
 ModbusClient::~ModbusClient() {
-    disconnect();
+    // The bus closes the port once its last device is gone
 }
 
 bool ModbusClient::connect() {
-    if (connected) {
-        return true;
+    if (!bus->connect()) {
+        lastError = bus->getLastError();
+        return false;
     }
+    return true;
+}
 
-    ctx = modbus_new_rtu(
-        connectionParams.port.c_str(),
-        connectionParams.baudRate,
-        connectionParams.parity,
-        connectionParams.dataBits,
-        connectionParams.stopBits
-    );
+void ModbusClient::disconnect() {
+    bus->disconnect();
+}
 
-    if (ctx == nullptr) {
-        lastError = "Failed to create Modbus RTU context";
-        std::cerr << "Error: " << lastError << std::endl;
-        return false;
-    }
+bool ModbusClient::isConnected() const {
+    return bus->isConnected();
+}
 
-    if (modbus_set_slave(ctx, deviceId) != 0) {
-        lastError = "Failed to set Modbus slave ID: " + std::string(modbus_strerror(errno));
+bool ModbusClient::selectDevice() {
+    if (!bus->isConnected()) {
+        lastError = "Not connected to Modbus device";
         std::cerr << "Error: " << lastError << std::endl;
-        modbus_free(ctx);
-        ctx = nullptr;
         return false;
     }
 
-    // Set timeouts for RTU communication
-    // Response timeout: 2 seconds (2000ms) - time to wait for response
-    // Byte timeout: 0.1 second (100ms) - time to wait between bytes
-    modbus_set_response_timeout(ctx, 2, 0);
-    modbus_set_byte_timeout(ctx, 0, 100000); // 100ms in microseconds
-
-    if (modbus_connect(ctx) != 0) {
-        lastError = "Failed to connect to Modbus device: " + std::string(modbus_strerror(errno));
+    if (!bus->selectSlave(deviceId)) {
+        lastError = bus->getLastError();
         std::cerr << "Error: " << lastError << std::endl;
-        modbus_free(ctx);
-        ctx = nullptr;
         return false;
     }
 
-    connected = true;
+    bus->setTimeouts(timeoutTuner.getResponseTimeout(), timeoutTuner.getByteTimeout());
     return true;
 }
 
-void ModbusClient::disconnect() {
-    if (ctx != nullptr) {
-        if (connected) {
-            modbus_close(ctx);
-        }
-        modbus_free(ctx);
-        ctx = nullptr;
-        connected = false;
+int ModbusClient::runRequest(const std::function<int(modbus_t*)>& request) {
+    auto start = std::chrono::steady_clock::now();
+    int result = request(bus->getContext());
+    if (result != -1) {
+        timeoutTuner.recordResponse(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
     }
+    return result;
 }
 
-bool ModbusClient::isConnected() const {
-    return connected;
+void ModbusClient::recordFailure(int errorCode) {
+    pacing.recordFailure(errorCode);
+    if (errorCode == ETIMEDOUT) {
+        timeoutTuner.recordTimeout();
+    }
 }
 
 bool ModbusClient::readRegisters(const std::vector<uint16_t>& addresses, std::vector<uint16_t>& values) {
-    if (!connected || ctx == nullptr) {
-        lastError = "Not connected to Modbus device";
-        std::cerr << "Error: " << lastError << std::endl;
+    if (!selectDevice()) {
         return false;
     }
 
@@ -90,58 +87,61 @@ bool ModbusClient::readRegisters(const std::vector<uint16_t>& addresses, std::ve
 
     for (uint16_t address : addresses) {
         uint16_t value;
-        int result = modbus_read_registers(ctx, address, 1, &value);
+        int result = runRequest([&](modbus_t* ctx) { return modbus_read_registers(ctx, address, 1, &value); });
         if (result == -1) {
-            lastError = "Failed to read register at address " + std::to_string(address) + ": " + std::string(modbus_strerror(errno));
+            int errorCode = errno;
+            lastError = "Failed to read register at address " + std::to_string(address) + ": " + std::string(modbus_strerror(errorCode));
+            recordFailure(errorCode);
             std::cerr << "Error: " << lastError << std::endl;
             return false;
         }
         values.push_back(value);
     }
 
+    pacing.recordSuccess();
     return true;
 }
 
 bool ModbusClient::readHoldingRegisters(uint16_t startAddress, uint16_t quantity, std::vector<uint16_t>& values) {
-    if (!connected || ctx == nullptr) {
-        lastError = "Not connected to Modbus device";
-        std::cerr << "Error: " << lastError << std::endl;
+    if (!selectDevice()) {
         return false;
     }
 
     values.resize(quantity);
-    int result = modbus_read_registers(ctx, startAddress, quantity, values.data());
+    int result = runRequest([&](modbus_t* ctx) { return modbus_read_registers(ctx, startAddress, quantity, values.data()); });
     if (result == -1) {
-        lastError = "Failed to read holding registers starting at " + std::to_string(startAddress) + ": " + std::string(modbus_strerror(errno));
+        int errorCode = errno;
+        lastError = "Failed to read holding registers starting at " + std::to_string(startAddress) + ": " + std::string(modbus_strerror(errorCode));
+        recordFailure(errorCode);
         std::cerr << "Error: " << lastError << std::endl;
         return false;
     }
 
+    pacing.recordSuccess();
     return true;
 }
 
 bool ModbusClient::readInputRegisters(uint16_t startAddress, uint16_t quantity, std::vector<uint16_t>& values) {
-    if (!connected || ctx == nullptr) {
-        lastError = "Not connected to Modbus device";
-        std::cerr << "Error: " << lastError << std::endl;
+    if (!selectDevice()) {
         return false;
     }
 
     values.resize(quantity);
-    int result = modbus_read_input_registers(ctx, startAddress, quantity, values.data());
+    int result = runRequest([&](modbus_t* ctx) { return modbus_read_input_registers(ctx, startAddress, quantity, values.data()); });
     if (result == -1) {
-        lastError = "Failed to read input registers starting at " + std::to_string(startAddress) + ": " + std::string(modbus_strerror(errno));
+        int errorCode = errno;
+        lastError = "Failed to read input registers starting at " + std::to_string(startAddress) + ": " + std::string(modbus_strerror(errorCode));
+        recordFailure(errorCode);
         std::cerr << "Error: " << lastError << std::endl;
         return false;
     }
 
+    pacing.recordSuccess();
     return true;
 }
 
 bool ModbusClient::readCoils(const std::vector<uint16_t>& addresses, std::vector<uint16_t>& values) {
-    if (!connected || ctx == nullptr) {
-        lastError = "Not connected to Modbus device";
-        std::cerr << "Error: " << lastError << std::endl;
+    if (!selectDevice()) {
         return false;
     }
 
@@ -150,22 +150,23 @@ bool ModbusClient::readCoils(const std::vector<uint16_t>& addresses, std::vector
 
     for (uint16_t address : addresses) {
         uint8_t bitValue;
-        int result = modbus_read_bits(ctx, address, 1, &bitValue);
+        int result = runRequest([&](modbus_t* ctx) { return modbus_read_bits(ctx, address, 1, &bitValue); });
         if (result == -1) {
-            lastError = "Failed to read coil at address " + std::to_string(address) + ": " + std::string(modbus_strerror(errno));
+            int errorCode = errno;
+            lastError = "Failed to read coil at address " + std::to_string(address) + ": " + std::string(modbus_strerror(errorCode));
+            recordFailure(errorCode);
             std::cerr << "Error: " << lastError << std::endl;
             return false;
         }
         values.push_back(static_cast<uint16_t>(bitValue));
     }
 
+    pacing.recordSuccess();
     return true;
 }
 
 bool ModbusClient::readDiscreteInputs(const std::vector<uint16_t>& addresses, std::vector<uint16_t>& values) {
-    if (!connected || ctx == nullptr) {
-        lastError = "Not connected to Modbus device";
-        std::cerr << "Error: " << lastError << std::endl;
+    if (!selectDevice()) {
         return false;
     }
 
@@ -174,30 +175,33 @@ bool ModbusClient::readDiscreteInputs(const std::vector<uint16_t>& addresses, st
 
     for (uint16_t address : addresses) {
         uint8_t bitValue;
-        int result = modbus_read_input_bits(ctx, address, 1, &bitValue);
+        int result = runRequest([&](modbus_t* ctx) { return modbus_read_input_bits(ctx, address, 1, &bitValue); });
         if (result == -1) {
-            lastError = "Failed to read discrete input at address " + std::to_string(address) + ": " + std::string(modbus_strerror(errno));
+            int errorCode = errno;
+            lastError = "Failed to read discrete input at address " + std::to_string(address) + ": " + std::string(modbus_strerror(errorCode));
+            recordFailure(errorCode);
             std::cerr << "Error: " << lastError << std::endl;
             return false;
         }
         values.push_back(static_cast<uint16_t>(bitValue));
     }
 
+    pacing.recordSuccess();
     return true;
 }
 
 bool ModbusClient::readCoils(uint16_t startAddress, uint16_t quantity, std::vector<uint16_t>& values) {
-    if (!connected || ctx == nullptr) {
-        lastError = "Not connected to Modbus device";
-        std::cerr << "Error: " << lastError << std::endl;
+    if (!selectDevice()) {
         return false;
     }
 
     values.resize(quantity);
     std::vector<uint8_t> bits(quantity);
-    int result = modbus_read_bits(ctx, startAddress, quantity, bits.data());
+    int result = runRequest([&](modbus_t* ctx) { return modbus_read_bits(ctx, startAddress, quantity, bits.data()); });
     if (result == -1) {
-        lastError = "Failed to read coils starting at " + std::to_string(startAddress) + ": " + std::string(modbus_strerror(errno));
+        int errorCode = errno;
+        lastError = "Failed to read coils starting at " + std::to_string(startAddress) + ": " + std::string(modbus_strerror(errorCode));
+        recordFailure(errorCode);
         std::cerr << "Error: " << lastError << std::endl;
         return false;
     }
@@ -206,21 +210,22 @@ bool ModbusClient::readCoils(uint16_t startAddress, uint16_t quantity, std::vect
         values[i] = static_cast<uint16_t>(bits[i]);
     }
 
+    pacing.recordSuccess();
     return true;
 }
 
 bool ModbusClient::readDiscreteInputs(uint16_t startAddress, uint16_t quantity, std::vector<uint16_t>& values) {
-    if (!connected || ctx == nullptr) {
-        lastError = "Not connected to Modbus device";
-        std::cerr << "Error: " << lastError << std::endl;
+    if (!selectDevice()) {
         return false;
     }
 
     values.resize(quantity);
     std::vector<uint8_t> bits(quantity);
-    int result = modbus_read_input_bits(ctx, startAddress, quantity, bits.data());
+    int result = runRequest([&](modbus_t* ctx) { return modbus_read_input_bits(ctx, startAddress, quantity, bits.data()); });
     if (result == -1) {
-        lastError = "Failed to read discrete inputs starting at " + std::to_string(startAddress) + ": " + std::string(modbus_strerror(errno));
+        int errorCode = errno;
+        lastError = "Failed to read discrete inputs starting at " + std::to_string(startAddress) + ": " + std::string(modbus_strerror(errorCode));
+        recordFailure(errorCode);
         std::cerr << "Error: " << lastError << std::endl;
         return false;
     }
@@ -229,14 +234,20 @@ bool ModbusClient::readDiscreteInputs(uint16_t startAddress, uint16_t quantity,
         values[i] = static_cast<uint16_t>(bits[i]);
     }
 
+    pacing.recordSuccess();
     return true;
 }
 
 void ModbusClient::flushBuffer() {
-    if (ctx != nullptr && connected) {
-        // Flush any remaining data in the serial buffer
-        modbus_flush(ctx);
-    }
+    bus->flush();
+}
+
+void ModbusClient::waitInterFrameDelay() {
+    std::this_thread::sleep_for(pacing.getDelay());
+}
+
+std::chrono::microseconds ModbusClient::getInterFrameDelay() const {
+    return pacing.getDelay();
 }
 
 std::string ModbusClient::getLastError() const {
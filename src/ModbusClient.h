@@ -1,20 +1,32 @@
 #ifndef MODBUSCLIENT_H
 #define MODBUSCLIENT_H
 
+#include "ModbusBus.h"
+#include "PacingController.h"
+#include "TimeoutTuner.h"
 #include "Types.h"
-#include <modbus/modbus.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace ModbusLogger {
 
+// One slave device. Requests go through a ModbusBus, which may be shared with
+// other devices on the same serial port.
 class ModbusClient {
 public:
+  // Device with a serial port of its own
   ModbusClient(const ConnectionParams &connection, int deviceId);
+  // Device on a bus shared with other slaves
+  ModbusClient(std::shared_ptr<ModbusBus> bus, int deviceId);
   ~ModbusClient();
 
   ModbusClient(const ModbusClient &) = delete;
   ModbusClient &operator=(const ModbusClient &) = delete;
 
+  // Open/close the underlying bus (affects every device sharing it)
   bool connect();
   void disconnect();
   bool isConnected() const;
@@ -36,13 +48,24 @@ public:
 
   void flushBuffer();
 
+  // Sleep for the adaptive inter-frame delay before the next request
+  void waitInterFrameDelay();
+  // Delay the pacing has currently settled on; callable from other threads
+  std::chrono::microseconds getInterFrameDelay() const;
+
   std::string getLastError() const;
 
 private:
-  ConnectionParams connectionParams;
+  // Check the bus is open and address it to this device
+  bool selectDevice();
+  // Run one libmodbus request, timing successful ones for the timeout tuner
+  int runRequest(const std::function<int(modbus_t *)> &request);
+  void recordFailure(int errorCode);
+
+  std::shared_ptr<ModbusBus> bus;
   int deviceId;
-  modbus_t *ctx;
-  bool connected;
+  PacingController pacing;
+  TimeoutTuner timeoutTuner;
   mutable std::string lastError;
 };
 
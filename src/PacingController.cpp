@@ -0,0 +1,80 @@
+#include "PacingController.h"
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <modbus/modbus.h>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr auto MAX_DELAY = std::chrono::microseconds(1000000);
+// Above 19200 baud the spec fixes t3.5 at 1.75 ms
+constexpr int FIXED_SILENT_BAUD = 19200;
+constexpr auto FIXED_SILENT_INTERVAL = std::chrono::microseconds(1750);
+// Successes in a row before the delay is lowered by a quarter
+constexpr uint32_t DECREASE_STREAK = 20;
+// Successes in a row before the failure floor is lowered by a quarter
+constexpr uint32_t FLOOR_DECAY_STREAK = 500;
+
+bool isLineError(int errorCode) {
+  return errorCode == ETIMEDOUT || errorCode == EMBBADCRC;
+}
+} // namespace
+
+PacingController::PacingController(const ConnectionParams &connection,
+                                   int deviceId)
+    : deviceId(deviceId), minDelay(silentInterval(connection)),
+      floorDelay(minDelay), delay(minDelay), successStreak(0) {}
+
+std::chrono::microseconds PacingController::getDelay() const {
+  return delay.load();
+}
+
+void PacingController::recordSuccess() {
+  ++successStreak;
+
+  if (successStreak % FLOOR_DECAY_STREAK == 0 && floorDelay > minDelay) {
+    floorDelay = std::max(minDelay, floorDelay * 3 / 4);
+  }
+
+  std::chrono::microseconds current = delay.load();
+  if (successStreak % DECREASE_STREAK == 0 && current > floorDelay) {
+    setDelay(std::max(floorDelay, current * 3 / 4), "lowered");
+  }
+}
+
+void PacingController::recordFailure(int errorCode) {
+  if (!isLineError(errorCode)) {
+    return;
+  }
+
+  successStreak = 0;
+  std::chrono::microseconds current = delay.load();
+  floorDelay = std::min(MAX_DELAY, current * 5 / 4);
+  setDelay(std::min(MAX_DELAY, current * 2), "raised");
+}
+
+std::chrono::microseconds
+PacingController::silentInterval(const ConnectionParams &connection) {
+  if (connection.baudRate <= 0 || connection.baudRate > FIXED_SILENT_BAUD) {
+    return FIXED_SILENT_INTERVAL;
+  }
+
+  // Start bit, data bits, optional parity bit, stop bits
+  int bitsPerChar = 1 + connection.dataBits + (connection.parity == 'N' ? 0 : 1) +
+                    connection.stopBits;
+  return std::chrono::microseconds(
+      static_cast<int64_t>(3.5 * bitsPerChar * 1000000.0 / connection.baudRate));
+}
+
+void PacingController::setDelay(std::chrono::microseconds newDelay,
+                                const char *reason) {
+  if (newDelay == delay.load()) {
+    return;
+  }
+  delay = newDelay;
+  std::cerr << "Device " << deviceId << ": inter-frame delay " << reason
+            << " to " << newDelay.count() / 1000.0 << " ms" << std::endl;
+}
+
+} // namespace ModbusLogger
@@ -0,0 +1,44 @@
+#ifndef PACINGCONTROLLER_H
+#define PACINGCONTROLLER_H
+
+#include "Types.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ModbusLogger {
+
+// Inter-frame delay of one device. Starts at the Modbus RTU 3.5-character
+// silent interval for the line settings, backs off when requests time out or
+// fail the CRC check, and creeps back down while requests succeed, never
+// below a delay that recently failed.
+class PacingController {
+public:
+  PacingController(const ConnectionParams &connection, int deviceId);
+
+  // Delay to keep between the end of a response and the next request; may
+  // be read from other threads
+  std::chrono::microseconds getDelay() const;
+
+  void recordSuccess();
+  // errorCode is the errno of the failed request; only line errors
+  // (timeouts, CRC errors) affect the delay
+  void recordFailure(int errorCode);
+
+  // Modbus RTU t3.5 for the given line settings
+  static std::chrono::microseconds
+  silentInterval(const ConnectionParams &connection);
+
+private:
+  void setDelay(std::chrono::microseconds newDelay, const char *reason);
+
+  int deviceId;
+  std::chrono::microseconds minDelay;
+  std::chrono::microseconds floorDelay; // Above the last delay that failed
+  std::atomic<std::chrono::microseconds> delay;
+  uint32_t successStreak;
+};
+
+} // namespace ModbusLogger
+
+#endif // PACINGCONTROLLER_H
@@ -3,69 +3,144 @@
 
 namespace ModbusLogger {
 
-PeriodicScheduler::PeriodicScheduler() 
-    : startTime(std::chrono::steady_clock::now()) {
+namespace {
+// Sleep while a range is overdue, e.g. retried after a failed read, so a
+// failing device is not polled in a busy loop
+constexpr auto OVERDUE_RETRY_DELAY = std::chrono::milliseconds(100);
+} // namespace
+
+PeriodicScheduler::PeriodicScheduler() {
 }
 
 void PeriodicScheduler::addRange(const RangeDefinition& range) {
     RangeSchedule schedule;
     schedule.range = &range;
-    schedule.period = PeriodParser::parsePeriod(range.period);
+    schedule.periodMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        PeriodParser::parsePeriod(range.period)).count();
     schedule.nextReadTime = std::chrono::steady_clock::now();
-    
+    schedule.nextReadMicros = toEpochMicros(std::chrono::system_clock::now());
+    schedule.heapPosition = heap.size();
+
+    indexByRange[&range] = schedules.size();
+    heap.push_back(schedules.size());
     schedules.push_back(schedule);
+    siftUp(heap.size() - 1);
 }
 
 std::vector<const RangeDefinition*> PeriodicScheduler::getRangesToRead() {
     std::vector<const RangeDefinition*> result;
     auto now = std::chrono::steady_clock::now();
     
-    for (auto& schedule : schedules) {
-        if (now >= schedule.nextReadTime) {
-            result.push_back(schedule.range);
+    // Walk the heap only below due entries; cost grows with the due ranges
+    std::vector<size_t> pending;
+    if (!heap.empty()) {
+        pending.push_back(0);
+    }
+    while (!pending.empty()) {
+        size_t position = pending.back();
+        pending.pop_back();
+        const RangeSchedule& schedule = schedules[heap[position]];
+        if (schedule.nextReadTime > now) {
+            continue;
+        }
+        result.push_back(schedule.range);
+        for (size_t child = 2 * position + 1; child <= 2 * position + 2 && child < heap.size(); ++child) {
+            pending.push_back(child);
         }
     }
     
     return result;
 }
 
+std::chrono::steady_clock::time_point PeriodicScheduler::getNextReadTime(const RangeDefinition& range) const {
+    auto it = indexByRange.find(&range);
+    if (it == indexByRange.end()) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return schedules[it->second].nextReadTime;
+}
+
 void PeriodicScheduler::markRangeRead(const RangeDefinition& range) {
-    for (auto& schedule : schedules) {
-        if (schedule.range == &range) {
-            // Update next read time to current time + period
-            schedule.nextReadTime = std::chrono::steady_clock::now() + schedule.period;
-            break;
-        }
+    auto it = indexByRange.find(&range);
+    if (it == indexByRange.end()) {
+        return;
     }
+    RangeSchedule& schedule = schedules[it->second];
+
+    auto steadyNow = std::chrono::steady_clock::now();
+    int64_t nowMicros = toEpochMicros(std::chrono::system_clock::now());
+
+    // First grid point after now, and after the deadline just served in
+    // case the clocks disagree by a little. A deadline further ahead means
+    // the wall clock was set back, so it is ignored.
+    int64_t after = nowMicros;
+    if (schedule.nextReadMicros > nowMicros &&
+        schedule.nextReadMicros - nowMicros < schedule.periodMicros) {
+        after = schedule.nextReadMicros;
+    }
+    int64_t next = (after / schedule.periodMicros + 1) * schedule.periodMicros;
+
+    schedule.nextReadMicros = next;
+    schedule.nextReadTime = steadyNow + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::microseconds(next - nowMicros));
+    siftUp(schedule.heapPosition);
+    siftDown(schedule.heapPosition);
 }
 
 std::chrono::milliseconds PeriodicScheduler::getTimeUntilNextRead() const {
-    if (schedules.empty()) {
+    if (heap.empty()) {
         return std::chrono::milliseconds(1000); // Default 1 second if no ranges
     }
     
     auto now = std::chrono::steady_clock::now();
-    auto minTime = now + std::chrono::hours(24); // Start with a large value
-    
-    for (const auto& schedule : schedules) {
-        if (schedule.nextReadTime < minTime) {
-            minTime = schedule.nextReadTime;
-        }
+    auto nextReadTime = schedules[heap.front()].nextReadTime;
+    if (nextReadTime <= now) {
+        return OVERDUE_RETRY_DELAY;
     }
     
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(minTime - now);
-    
-    // Return at least 100ms to avoid busy waiting
-    if (duration.count() < 100) {
-        return std::chrono::milliseconds(100);
-    }
-    
-    return duration;
+    // Rounded up, so the wakeup is not just before the deadline
+    return std::chrono::ceil<std::chrono::milliseconds>(nextReadTime - now);
 }
 
 bool PeriodicScheduler::hasRanges() const {
     return !schedules.empty();
 }
 
-} // namespace ModbusLogger
+void PeriodicScheduler::siftUp(size_t position) {
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (!isEarlier(position, parent)) {
+            break;
+        }
+        swapHeap(position, parent);
+        position = parent;
+    }
+}
 
+void PeriodicScheduler::siftDown(size_t position) {
+    while (true) {
+        size_t earliest = position;
+        for (size_t child = 2 * position + 1; child <= 2 * position + 2 && child < heap.size(); ++child) {
+            if (isEarlier(child, earliest)) {
+                earliest = child;
+            }
+        }
+        if (earliest == position) {
+            break;
+        }
+        swapHeap(position, earliest);
+        position = earliest;
+    }
+}
+
+bool PeriodicScheduler::isEarlier(size_t a, size_t b) const {
+    return schedules[heap[a]].nextReadTime < schedules[heap[b]].nextReadTime;
+}
+
+void PeriodicScheduler::swapHeap(size_t a, size_t b) {
+    std::swap(heap[a], heap[b]);
+    schedules[heap[a]].heapPosition = a;
+    schedules[heap[b]].heapPosition = b;
+}
+
+} // namespace ModbusLogger
@@ -5,11 +5,17 @@
 #include "PeriodParser.h"
 #include <chrono>
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include <cstdint>
 
 namespace ModbusLogger {
 
+// Read deadlines of a device's ranges, kept in a min-heap. After its first
+// read (due at once) a range is due on the wall-clock grid of its period:
+// multiples of the period since the Unix epoch, so a 20s range is read at
+// :00/:20/:40 and a 1h range on the hour (UTC). The next deadline is the
+// first grid point after the read, so read latency does not accumulate and
+// missed slots are skipped rather than read in a burst.
 class PeriodicScheduler {
 public:
     PeriodicScheduler();
@@ -20,7 +26,10 @@ public:
     // Get ranges that need to be read now
     std::vector<const RangeDefinition*> getRangesToRead();
     
-    // Mark range as read (update next read time)
+    // Time the range is due (for ordering reads by deadline)
+    std::chrono::steady_clock::time_point getNextReadTime(const RangeDefinition& range) const;
+    
+    // Mark range as read (move it to the next grid point)
     void markRangeRead(const RangeDefinition& range);
     
     // Get time until next range needs reading (for sleep optimization)
@@ -33,14 +42,22 @@ private:
     struct RangeSchedule {
         const RangeDefinition* range;
         std::chrono::steady_clock::time_point nextReadTime;
-        std::chrono::seconds period;
+        int64_t nextReadMicros; // Same deadline in wall-clock epoch micros
+        int64_t periodMicros;
+        size_t heapPosition;
     };
+
+    // Restore the heap order after the deadline at position changed
+    void siftUp(size_t position);
+    void siftDown(size_t position);
+    bool isEarlier(size_t a, size_t b) const;
+    void swapHeap(size_t a, size_t b);
     
     std::vector<RangeSchedule> schedules;
-    std::chrono::steady_clock::time_point startTime;
+    std::vector<size_t> heap; // Schedule indexes, earliest deadline first
+    std::unordered_map<const RangeDefinition*, size_t> indexByRange;
 };
 
 } // namespace ModbusLogger
 
 #endif // PERIODICSCHEDULER_H
-
@@ -0,0 +1,167 @@
+#include "ReadPlanner.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace ModbusLogger {
+
+namespace {
+// Protocol limits per request
+constexpr uint32_t MAX_READ_REGISTERS = 125;
+constexpr uint32_t MAX_READ_BITS = 2000;
+
+// Line cost of one extra frame, in bits: request (8 bytes), response header
+// and CRC (5 bytes), two t3.5 silences (7 characters) and a typical slave
+// turnaround (20 characters)
+constexpr uint32_t FRAME_COST_BITS = (8 + 5 + 7 + 20) * 8;
+
+bool isBitType(ModbusRegisterType regType) {
+  return regType == ModbusRegisterType::Coil ||
+         regType == ModbusRegisterType::Discrete;
+}
+} // namespace
+
+std::vector<RangeDefinition>
+ReadPlanner::planScheduled(const DeviceConfig &device) {
+  return plan(device, true);
+}
+
+std::vector<RangeDefinition> ReadPlanner::planAll(const DeviceConfig &device) {
+  return plan(device, false);
+}
+
+std::string ReadPlanner::resolvePeriod(const DeviceConfig &device,
+                                       const RegisterDefinition &reg) {
+  if (reg.isVirtual) {
+    return "";
+  }
+  if (!reg.period.empty()) {
+    return reg.period;
+  }
+
+  for (const auto &range : device.ranges) {
+    if (range.regType == reg.regType && reg.address >= range.start &&
+        reg.address < range.start + range.count) {
+      return range.period;
+    }
+  }
+  return "";
+}
+
+uint16_t ReadPlanner::getWordCount(const RegisterDefinition &reg) {
+  return getWordCount(reg.type);
+}
+
+uint16_t ReadPlanner::getWordCount(RegisterType type) {
+  if (type == RegisterType::Int32 || type == RegisterType::Float32 ||
+      type == RegisterType::Uint32) {
+    return 2;
+  } else if (type == RegisterType::Uint64) {
+    return 4;
+  } else {
+    return 1;
+  }
+}
+
+std::vector<RangeDefinition> ReadPlanner::plan(const DeviceConfig &device,
+                                               bool withPeriods) {
+  std::map<std::pair<ModbusRegisterType, std::string>, std::vector<Item>>
+      groups;
+  for (const auto &reg : device.registers) {
+    if (!reg.enabled || reg.isVirtual) {
+      continue;
+    }
+
+    std::string period;
+    if (withPeriods) {
+      period = resolvePeriod(device, reg);
+      if (period.empty()) {
+        continue;
+      }
+    }
+
+    Item item;
+    item.start = reg.address;
+    item.end = item.start + getWordCount(reg);
+    groups[{reg.regType, period}].push_back(item);
+  }
+
+  std::vector<RangeDefinition> ranges;
+  for (auto &[key, items] : groups) {
+    planGroup(device, items, key.first, key.second, ranges);
+  }
+  return ranges;
+}
+
+void ReadPlanner::planGroup(const DeviceConfig &device,
+                            std::vector<Item> &items,
+                            ModbusRegisterType regType,
+                            const std::string &period,
+                            std::vector<RangeDefinition> &ranges) {
+  std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+    return a.start < b.start || (a.start == b.start && a.end < b.end);
+  });
+
+  bool bits = isBitType(regType);
+  uint32_t unitBits = bits ? 1 : 16;
+  uint32_t maxSpan =
+      bits ? MAX_READ_BITS
+           : std::min<uint32_t>(MAX_READ_REGISTERS, device.maxReadWords);
+  // Widest gap worth reading instead of starting a new frame
+  uint32_t maxGap = device.maxReadGap >= 0
+                        ? static_cast<uint32_t>(device.maxReadGap)
+                        : FRAME_COST_BITS / unitBits;
+
+  // cost[i] is the cheapest way to read items [0, i); first[i] is where the
+  // last request of that plan starts
+  size_t count = items.size();
+  std::vector<uint64_t> cost(count + 1, std::numeric_limits<uint64_t>::max());
+  std::vector<size_t> first(count + 1, 0);
+  cost[0] = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    // Try every request that ends with item i, growing it to the left
+    uint32_t end = items[i].end;
+    uint32_t widestGap = 0;
+    for (size_t j = i + 1; j-- > 0;) {
+      end = std::max(end, items[j].end);
+      if (j < i && items[j + 1].start > items[j].end) {
+        widestGap = std::max(widestGap, items[j + 1].start - items[j].end);
+      }
+
+      uint32_t span = end - items[j].start;
+      if ((span > maxSpan || widestGap > maxGap) && j < i) {
+        break; // Growing further left only makes it worse
+      }
+
+      uint64_t candidate =
+          cost[j] + FRAME_COST_BITS + static_cast<uint64_t>(span) * unitBits;
+      if (candidate < cost[i + 1]) {
+        cost[i + 1] = candidate;
+        first[i + 1] = j;
+      }
+    }
+  }
+
+  // Walk back through the chosen requests
+  std::vector<RangeDefinition> planned;
+  for (size_t i = count; i > 0; i = first[i]) {
+    size_t j = first[i];
+    uint32_t end = 0;
+    for (size_t k = j; k < i; ++k) {
+      end = std::max(end, items[k].end);
+    }
+
+    RangeDefinition range;
+    range.start = static_cast<uint16_t>(items[j].start);
+    range.count = static_cast<uint16_t>(end - items[j].start);
+    range.period = period;
+    range.regType = regType;
+    planned.push_back(range);
+  }
+
+  ranges.insert(ranges.end(), planned.rbegin(), planned.rend());
+}
+
+} // namespace ModbusLogger
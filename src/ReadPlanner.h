@@ -0,0 +1,48 @@
+#ifndef READPLANNER_H
+#define READPLANNER_H
+
+#include "Types.h"
+#include <string>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Turns a device's enabled registers into the cheapest set of read requests.
+// Registers are grouped by Modbus register type and period, and each group is
+// split into requests that respect the protocol limits (125 registers or 2000
+// bits per request). Neighbouring registers share a request, including across
+// a gap, whenever reading the gap costs fewer line bytes than an extra frame.
+class ReadPlanner {
+public:
+  // Plan reads for the continuous loop; registers without a period are
+  // skipped
+  static std::vector<RangeDefinition> planScheduled(const DeviceConfig &device);
+
+  // Plan reads of every enabled register regardless of period (single run)
+  static std::vector<RangeDefinition> planAll(const DeviceConfig &device);
+
+  // Register's own period, else the period of the configured range that
+  // contains it, else "" (always for virtual registers)
+  static std::string resolvePeriod(const DeviceConfig &device,
+                                   const RegisterDefinition &reg);
+
+  // Number of 16-bit words (or bits for coils/discrete inputs) a register uses
+  static uint16_t getWordCount(const RegisterDefinition &reg);
+  static uint16_t getWordCount(RegisterType type);
+
+private:
+  struct Item {
+    uint32_t start;
+    uint32_t end; // Exclusive
+  };
+
+  static std::vector<RangeDefinition> plan(const DeviceConfig &device,
+                                           bool withPeriods);
+  static void planGroup(const DeviceConfig &device, std::vector<Item> &items,
+                        ModbusRegisterType regType, const std::string &period,
+                        std::vector<RangeDefinition> &ranges);
+};
+
+} // namespace ModbusLogger
+
+#endif // READPLANNER_H
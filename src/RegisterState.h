@@ -0,0 +1,67 @@
+#ifndef REGISTERSTATE_H
+#define REGISTERSTATE_H
+
+#include "SwingingDoor.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Change-tracking state of one device's registers. Each field is a separate
+// array indexed by register id (RegisterDefinition::id), so the poll loop
+// reads and updates it without lookups or string comparisons.
+class RegisterState {
+public:
+  enum Flags : uint8_t {
+    HAS_VALUE = 1 << 0,      // lastValues holds a stored value
+    HAS_WRITE_TIME = 1 << 1, // Written by this process at lastWriteTimes
+  };
+
+  explicit RegisterState(size_t count = 0) { resize(count); }
+
+  void resize(size_t count) {
+    lastValues.assign(count, 0.0);
+    lastWriteTimes.assign(count, std::chrono::steady_clock::time_point());
+    periods.assign(count, std::chrono::seconds(0));
+    maxSilences.assign(count, std::chrono::seconds(0));
+    flags.assign(count, 0);
+    doors.assign(count, SwingingDoor());
+  }
+
+  size_t size() const { return flags.size(); }
+
+  bool hasValue(uint16_t id) const { return flags[id] & HAS_VALUE; }
+  bool hasWriteTime(uint16_t id) const { return flags[id] & HAS_WRITE_TIME; }
+
+  // Last value known to be stored, e.g. loaded from the database
+  void setLastValue(uint16_t id, double value) {
+    lastValues[id] = value;
+    flags[id] |= HAS_VALUE;
+  }
+
+  void recordWrite(uint16_t id, double value,
+                   std::chrono::steady_clock::time_point time) {
+    lastValues[id] = value;
+    lastWriteTimes[id] = time;
+    flags[id] |= HAS_VALUE | HAS_WRITE_TIME;
+  }
+
+  // The write at lastWriteTimes did not reach the database after all: the
+  // next value is written whether it changed or not
+  void forgetWrite(uint16_t id) {
+    flags[id] &= static_cast<uint8_t>(~HAS_WRITE_TIME);
+  }
+
+  std::vector<double> lastValues;
+  std::vector<std::chrono::steady_clock::time_point> lastWriteTimes;
+  std::vector<std::chrono::seconds> periods;
+  std::vector<std::chrono::seconds> maxSilences; // 0 = no heartbeat
+  std::vector<uint8_t> flags;
+  std::vector<SwingingDoor> doors; // Used by swinging-door registers only
+};
+
+} // namespace ModbusLogger
+
+#endif // REGISTERSTATE_H
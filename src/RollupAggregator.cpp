@@ -0,0 +1,135 @@
+#include "RollupAggregator.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr int64_t NO_OPEN_BUCKET = std::numeric_limits<int64_t>::max();
+
+int64_t bucketStart(int64_t micros, int64_t widthMicros) {
+  int64_t start = micros - micros % widthMicros;
+  return micros < 0 && start != micros ? start - widthMicros : start;
+}
+} // namespace
+
+RollupAggregator::RollupAggregator(
+    int deviceId, const std::vector<RegisterDefinition> &registers,
+    const std::vector<RollupInterval> &intervals)
+    : deviceId(deviceId) {
+  names.reserve(registers.size());
+  for (const auto &reg : registers) {
+    names.push_back(reg.name);
+  }
+  for (RollupInterval interval : intervals) {
+    Level level;
+    level.interval = interval;
+    level.widthMicros =
+        std::chrono::duration_cast<std::chrono::microseconds>(getWidth(interval))
+            .count();
+    level.nextEndMicros = NO_OPEN_BUCKET;
+    level.buckets.assign(registers.size(), Bucket{0, 0.0, 0.0, 0.0, 0.0, 0.0, 0});
+    levels.push_back(std::move(level));
+  }
+}
+
+void RollupAggregator::add(uint16_t registerId, double value,
+                           std::chrono::system_clock::time_point timestamp) {
+  if (!std::isfinite(value)) {
+    return;
+  }
+
+  int64_t micros = toEpochMicros(timestamp);
+  for (Level &level : levels) {
+    Bucket &bucket = level.buckets[registerId];
+    int64_t start = bucketStart(micros, level.widthMicros);
+    if (bucket.count > 0 && bucket.startMicros != start) {
+      // Not collected yet (or the clock stepped back)
+      close(level, registerId, bucket, closed);
+    }
+
+    if (bucket.count == 0) {
+      bucket = {start, value, value, 0.0, value, value, 0};
+      level.nextEndMicros =
+          std::min(level.nextEndMicros, start + level.widthMicros);
+    }
+    bucket.min = std::min(bucket.min, value);
+    bucket.max = std::max(bucket.max, value);
+    bucket.sum += value;
+    bucket.last = value;
+    ++bucket.count;
+  }
+}
+
+void RollupAggregator::collect(std::chrono::system_clock::time_point now,
+                               std::vector<RollupRow> &rows) {
+  std::move(closed.begin(), closed.end(), std::back_inserter(rows));
+  closed.clear();
+
+  int64_t nowMicros = toEpochMicros(now);
+  for (Level &level : levels) {
+    if (nowMicros < level.nextEndMicros) {
+      continue; // Nothing ended yet, skip the scan
+    }
+    level.nextEndMicros = NO_OPEN_BUCKET;
+    for (size_t id = 0; id < level.buckets.size(); ++id) {
+      Bucket &bucket = level.buckets[id];
+      if (bucket.count == 0) {
+        continue;
+      }
+      int64_t end = bucket.startMicros + level.widthMicros;
+      if (end <= nowMicros) {
+        close(level, static_cast<uint16_t>(id), bucket, rows);
+      } else {
+        level.nextEndMicros = std::min(level.nextEndMicros, end);
+      }
+    }
+  }
+}
+
+void RollupAggregator::collectAll(std::vector<RollupRow> &rows) {
+  std::move(closed.begin(), closed.end(), std::back_inserter(rows));
+  closed.clear();
+
+  for (Level &level : levels) {
+    for (size_t id = 0; id < level.buckets.size(); ++id) {
+      if (level.buckets[id].count > 0) {
+        close(level, static_cast<uint16_t>(id), level.buckets[id], rows);
+      }
+    }
+    level.nextEndMicros = NO_OPEN_BUCKET;
+  }
+}
+
+std::chrono::seconds RollupAggregator::getWidth(RollupInterval interval) {
+  switch (interval) {
+  case RollupInterval::Minute:
+    return std::chrono::minutes(1);
+  case RollupInterval::Hour:
+    return std::chrono::hours(1);
+  case RollupInterval::Day:
+  default:
+    return std::chrono::hours(24);
+  }
+}
+
+void RollupAggregator::close(const Level &level, uint16_t registerId,
+                             Bucket &bucket, std::vector<RollupRow> &rows) {
+  RollupRow row;
+  row.interval = level.interval;
+  row.deviceId = deviceId;
+  row.registerName = names[registerId];
+  row.bucket = fromEpochMicros(bucket.startMicros);
+  row.min = bucket.min;
+  row.max = bucket.max;
+  row.avg = bucket.sum / bucket.count;
+  row.first = bucket.first;
+  row.last = bucket.last;
+  row.count = bucket.count;
+  rows.push_back(std::move(row));
+  bucket.count = 0;
+}
+
+} // namespace ModbusLogger
@@ -0,0 +1,65 @@
+#ifndef ROLLUPAGGREGATOR_H
+#define ROLLUPAGGREGATOR_H
+
+#include "Types.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Streaming min/max/avg/first/last/count of every read value of one device's
+// registers over UTC-aligned time buckets. Buckets close once time passes
+// their end, all registers of an interval together, so each boundary yields
+// one batch of rows for the rollup tables.
+class RollupAggregator {
+public:
+  // registers is the device's full register list, indexed by register id
+  RollupAggregator(int deviceId,
+                   const std::vector<RegisterDefinition> &registers,
+                   const std::vector<RollupInterval> &intervals);
+
+  void add(uint16_t registerId, double value,
+           std::chrono::system_clock::time_point timestamp);
+
+  // Append the rows of buckets that ended by now
+  void collect(std::chrono::system_clock::time_point now,
+               std::vector<RollupRow> &rows);
+
+  // Append the rows of all buckets, also open ones (at shutdown; the rollup
+  // tables merge partial buckets)
+  void collectAll(std::vector<RollupRow> &rows);
+
+  static std::chrono::seconds getWidth(RollupInterval interval);
+
+private:
+  struct Bucket {
+    int64_t startMicros;
+    double min;
+    double max;
+    double sum;
+    double first;
+    double last;
+    uint32_t count; // 0 = no open bucket
+  };
+
+  struct Level {
+    RollupInterval interval;
+    int64_t widthMicros;
+    int64_t nextEndMicros; // Earliest end of an open bucket
+    std::vector<Bucket> buckets; // By register id
+  };
+
+  void close(const Level &level, uint16_t registerId, Bucket &bucket,
+             std::vector<RollupRow> &rows);
+
+  int deviceId;
+  std::vector<std::string> names; // By register id
+  std::vector<Level> levels;
+  std::vector<RollupRow> closed; // Closed by add() before the next collect
+};
+
+} // namespace ModbusLogger
+
+#endif // ROLLUPAGGREGATOR_H
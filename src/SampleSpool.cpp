@@ -0,0 +1,363 @@
+#include "SampleSpool.h"
+#include "Crc32.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr uint32_t SEGMENT_MAGIC = 0x4D4C5350; // "MLSP"
+constexpr uint16_t SEGMENT_VERSION = 1;
+constexpr uint32_t RECORD_MARKER = 0x5245434F; // Zero marks an unused slot
+constexpr uint32_t SEGMENT_CAPACITY = 16384;   // Records per segment file
+constexpr size_t MAX_NAME_LENGTH = 63;
+constexpr const char *SEGMENT_PREFIX = "segment-";
+constexpr const char *SEGMENT_SUFFIX = ".spool";
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t capacity;
+  uint32_t crc; // Over the fields above
+};
+
+struct SpoolRecord {
+  uint32_t marker;
+  int32_t deviceId;
+  int64_t timestampMicros;
+  double value;
+  uint8_t nameLength;
+  char registerName[MAX_NAME_LENGTH];
+  uint32_t crc; // Over all fields above
+  uint32_t reserved;
+};
+
+static_assert(sizeof(SegmentHeader) == 16, "Unexpected spool header layout");
+static_assert(sizeof(SpoolRecord) == 96, "Unexpected spool record layout");
+
+constexpr size_t SEGMENT_BYTES =
+    sizeof(SegmentHeader) + SEGMENT_CAPACITY * sizeof(SpoolRecord);
+
+uint32_t headerCrc(const SegmentHeader &header) {
+  return crc32(&header, offsetof(SegmentHeader, crc));
+}
+
+uint32_t recordCrc(const SpoolRecord &record) {
+  return crc32(&record, offsetof(SpoolRecord, crc));
+}
+
+SpoolRecord *recordAt(void *map, uint32_t index) {
+  return reinterpret_cast<SpoolRecord *>(static_cast<char *>(map) +
+                                         sizeof(SegmentHeader)) +
+         index;
+}
+
+// Parse "segment-<sequence>.spool"; returns false for any other file
+bool parseSegmentName(const std::string &fileName, uint64_t &sequence) {
+  std::string prefix = SEGMENT_PREFIX;
+  std::string suffix = SEGMENT_SUFFIX;
+  if (fileName.size() <= prefix.size() + suffix.size() ||
+      fileName.compare(0, prefix.size(), prefix) != 0 ||
+      fileName.compare(fileName.size() - suffix.size(), suffix.size(),
+                       suffix) != 0) {
+    return false;
+  }
+  std::string digits = fileName.substr(
+      prefix.size(), fileName.size() - prefix.size() - suffix.size());
+  if (!std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+    return false;
+  }
+  sequence = std::stoull(digits);
+  return true;
+}
+} // namespace
+
+SampleSpool::SampleSpool(const std::string &directory)
+    : directory(directory), nextSequence(1), sealedRows(0), opened(false),
+      activeFd(-1), activeMap(nullptr), activeSequence(0), activeCount(0) {}
+
+SampleSpool::~SampleSpool() { close(); }
+
+bool SampleSpool::open() {
+  if (opened) {
+    return true;
+  }
+
+  try {
+    std::filesystem::create_directories(directory);
+
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+      uint64_t sequence;
+      if (entry.is_regular_file() &&
+          parseSegmentName(entry.path().filename().string(), sequence)) {
+        sealedSegments.push_back(sequence);
+      }
+    }
+  } catch (const std::filesystem::filesystem_error &e) {
+    lastError = "Cannot open spool directory " + directory + ": " + e.what();
+    return false;
+  }
+
+  // Segments from a previous run are never appended to again
+  std::sort(sealedSegments.begin(), sealedSegments.end());
+  if (!sealedSegments.empty()) {
+    nextSequence = sealedSegments.back() + 1;
+  }
+
+  for (uint64_t sequence : sealedSegments) {
+    std::vector<SampleRow> rows;
+    size_t corrupt = 0;
+    if (readSegment(segmentPath(sequence), rows, corrupt)) {
+      sealedRows += rows.size();
+    }
+  }
+
+  opened = true;
+  return true;
+}
+
+void SampleSpool::close() {
+  sealActiveSegment();
+  sealedSegments.clear();
+  sealedRows = 0;
+  opened = false;
+}
+
+bool SampleSpool::isOpen() const { return opened; }
+
+size_t SampleSpool::append(const std::vector<SampleRow> &rows) {
+  if (!opened) {
+    return 0;
+  }
+
+  size_t appended = 0;
+  for (const SampleRow &row : rows) {
+    if (row.registerName.size() > MAX_NAME_LENGTH) {
+      std::cerr << "Warning: Register name too long to spool: "
+                << row.registerName << std::endl;
+      continue;
+    }
+
+    if (activeMap != nullptr && activeCount >= SEGMENT_CAPACITY) {
+      sealActiveSegment();
+    }
+    if (activeMap == nullptr && !openActiveSegment()) {
+      std::cerr << "Error: " << lastError << std::endl;
+      break;
+    }
+
+    SpoolRecord record{};
+    record.marker = RECORD_MARKER;
+    record.deviceId = row.deviceId;
+    record.timestampMicros = toEpochMicros(row.timestamp);
+    record.value = row.value;
+    record.nameLength = static_cast<uint8_t>(row.registerName.size());
+    std::memcpy(record.registerName, row.registerName.data(),
+                row.registerName.size());
+    record.crc = recordCrc(record);
+
+    *recordAt(activeMap, activeCount) = record;
+    ++activeCount;
+    ++appended;
+  }
+
+  if (activeMap != nullptr && appended > 0) {
+    msync(activeMap, SEGMENT_BYTES, MS_ASYNC);
+  }
+  return appended;
+}
+
+size_t SampleSpool::replay(const ReplayFunction &replayFunction) {
+  if (!opened) {
+    return 0;
+  }
+
+  // Replay includes what was spooled so far in the active segment
+  sealActiveSegment();
+
+  size_t replayed = 0;
+  while (!sealedSegments.empty()) {
+    uint64_t sequence = sealedSegments.front();
+    std::string path = segmentPath(sequence);
+
+    std::vector<SampleRow> rows;
+    size_t corrupt = 0;
+    if (!readSegment(path, rows, corrupt)) {
+      std::cerr << "Error: " << lastError << ", discarding segment"
+                << std::endl;
+    } else if (corrupt > 0) {
+      std::cerr << "Warning: Skipping " << corrupt
+                << " corrupt records in spool segment " << path << std::endl;
+    }
+
+    // A segment is kept entirely until it has been written; rows already
+    // stored by an interrupted attempt are written again next time
+    if (!rows.empty() && !replayFunction(rows)) {
+      break;
+    }
+
+    std::remove(path.c_str());
+    sealedSegments.erase(sealedSegments.begin());
+    sealedRows -= std::min<uint64_t>(sealedRows, rows.size());
+    replayed += rows.size();
+  }
+
+  return replayed;
+}
+
+bool SampleSpool::hasPending() const { return pendingRows() > 0; }
+
+uint64_t SampleSpool::pendingRows() const { return sealedRows + activeCount; }
+
+std::string SampleSpool::getLastError() const { return lastError; }
+
+bool SampleSpool::openActiveSegment() {
+  uint64_t sequence = nextSequence;
+  std::string path = segmentPath(sequence);
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    lastError = "Cannot create spool segment " + path + ": " +
+                std::string(std::strerror(errno));
+    return false;
+  }
+
+  if (ftruncate(fd, SEGMENT_BYTES) != 0) {
+    lastError = "Cannot size spool segment " + path + ": " +
+                std::string(std::strerror(errno));
+    ::close(fd);
+    std::remove(path.c_str());
+    return false;
+  }
+
+  void *map =
+      mmap(nullptr, SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    lastError = "Cannot map spool segment " + path + ": " +
+                std::string(std::strerror(errno));
+    ::close(fd);
+    std::remove(path.c_str());
+    return false;
+  }
+
+  SegmentHeader header{};
+  header.magic = SEGMENT_MAGIC;
+  header.version = SEGMENT_VERSION;
+  header.recordSize = sizeof(SpoolRecord);
+  header.capacity = SEGMENT_CAPACITY;
+  header.crc = headerCrc(header);
+  std::memcpy(map, &header, sizeof(header));
+
+  ++nextSequence;
+  activeFd = fd;
+  activeMap = map;
+  activeSequence = sequence;
+  activeCount = 0;
+  return true;
+}
+
+void SampleSpool::sealActiveSegment() {
+  if (activeMap == nullptr) {
+    return;
+  }
+
+  msync(activeMap, SEGMENT_BYTES, MS_SYNC);
+  munmap(activeMap, SEGMENT_BYTES);
+  ::close(activeFd);
+
+  if (activeCount > 0) {
+    sealedSegments.push_back(activeSequence);
+    sealedRows += activeCount;
+  } else {
+    std::remove(segmentPath(activeSequence).c_str());
+  }
+
+  activeFd = -1;
+  activeMap = nullptr;
+  activeCount = 0;
+}
+
+std::string SampleSpool::segmentPath(uint64_t sequence) const {
+  char fileName[64];
+  std::snprintf(fileName, sizeof(fileName), "%s%016llu%s", SEGMENT_PREFIX,
+                static_cast<unsigned long long>(sequence), SEGMENT_SUFFIX);
+  return (std::filesystem::path(directory) / fileName).string();
+}
+
+bool SampleSpool::readSegment(const std::string &path,
+                              std::vector<SampleRow> &rows, size_t &corrupt) {
+  rows.clear();
+  corrupt = 0;
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    lastError = "Cannot open spool segment " + path + ": " +
+                std::string(std::strerror(errno));
+    return false;
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 ||
+      static_cast<size_t>(fileStat.st_size) < sizeof(SegmentHeader)) {
+    lastError = "Spool segment " + path + " is truncated";
+    ::close(fd);
+    return false;
+  }
+
+  size_t fileSize = static_cast<size_t>(fileStat.st_size);
+  void *map = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    lastError = "Cannot map spool segment " + path + ": " +
+                std::string(std::strerror(errno));
+    return false;
+  }
+
+  SegmentHeader header;
+  std::memcpy(&header, map, sizeof(header));
+  if (header.magic != SEGMENT_MAGIC || header.version != SEGMENT_VERSION ||
+      header.recordSize != sizeof(SpoolRecord) ||
+      header.crc != headerCrc(header)) {
+    lastError = "Spool segment " + path + " has an invalid header";
+    munmap(map, fileSize);
+    return false;
+  }
+
+  uint32_t capacity = std::min<uint64_t>(
+      header.capacity,
+      (fileSize - sizeof(SegmentHeader)) / sizeof(SpoolRecord));
+  rows.reserve(capacity);
+  for (uint32_t i = 0; i < capacity; ++i) {
+    const SpoolRecord &record = *recordAt(map, i);
+    if (record.marker == 0) {
+      break; // Records are appended in order; the rest is unused
+    }
+    if (record.marker != RECORD_MARKER || record.crc != recordCrc(record) ||
+        record.nameLength > MAX_NAME_LENGTH) {
+      ++corrupt;
+      continue;
+    }
+
+    SampleRow row;
+    row.deviceId = record.deviceId;
+    row.timestamp = fromEpochMicros(record.timestampMicros);
+    row.registerName.assign(record.registerName, record.nameLength);
+    row.value = record.value;
+    rows.push_back(std::move(row));
+  }
+
+  munmap(map, fileSize);
+  return true;
+}
+
+} // namespace ModbusLogger
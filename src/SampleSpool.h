@@ -0,0 +1,68 @@
+#ifndef SAMPLESPOOL_H
+#define SAMPLESPOOL_H
+
+#include "Types.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Append-only on-disk buffer for samples that could not be written to the
+// database. Samples go into fixed-size, memory-mapped segment files of
+// CRC-checked records; segments left over from a previous run are picked up
+// again on open. Only the writer thread uses it, so it is not thread-safe.
+class SampleSpool {
+public:
+  // Writes one sealed segment's rows; returns false to keep the segment
+  using ReplayFunction = std::function<bool(const std::vector<SampleRow> &)>;
+
+  explicit SampleSpool(const std::string &directory);
+  ~SampleSpool();
+
+  SampleSpool(const SampleSpool &) = delete;
+  SampleSpool &operator=(const SampleSpool &) = delete;
+
+  // Create the directory and scan it for segments left by a previous run
+  bool open();
+  void close();
+  bool isOpen() const;
+
+  // Append rows; returns the number of rows stored
+  size_t append(const std::vector<SampleRow> &rows);
+
+  // Hand every segment to replay, oldest first, deleting each one that was
+  // written. Stops at the first failure. Returns the number of rows replayed.
+  size_t replay(const ReplayFunction &replayFunction);
+
+  bool hasPending() const;
+  uint64_t pendingRows() const;
+
+  std::string getLastError() const;
+
+private:
+  bool openActiveSegment();
+  void sealActiveSegment();
+  std::string segmentPath(uint64_t sequence) const;
+  bool readSegment(const std::string &path, std::vector<SampleRow> &rows,
+                   size_t &corrupt);
+
+  std::string directory;
+  std::vector<uint64_t> sealedSegments; // Oldest first
+  uint64_t nextSequence;
+  uint64_t sealedRows;
+  bool opened;
+
+  // Active segment
+  int activeFd;
+  void *activeMap;
+  uint64_t activeSequence;
+  uint32_t activeCount;
+
+  std::string lastError;
+};
+
+} // namespace ModbusLogger
+
+#endif // SAMPLESPOOL_H
@@ -9,6 +9,17 @@ namespace ModbusLogger {
 
 namespace {
 constexpr const char *TIMESTAMP_COLUMN_NAME = "timestamp";
+constexpr const char *REGISTERS_TABLE_NAME = "registers";
+constexpr const char *SAMPLES_TABLE_NAME = "modbus_samples";
+constexpr const char *TARIFF_TOTALS_TABLE_NAME = "modbus_tariff_totals";
+// View with the columns of the original table, for queries in sql/
+constexpr const char *DATA_VIEW_NAME = "modbus_data";
+// Original table with register names in every row, renamed on upgrade
+constexpr const char *LEGACY_TABLE_NAME = "modbus_data_legacy";
+// Type of wide-mode value columns, as of modbus_samples.value: stored values
+// are already scaled and may come from an expression, so the raw register
+// type says nothing about their range or precision
+constexpr const char *DOUBLE_PRECISION_TYPE = "DOUBLE PRECISION";
 
 std::string quoteIdentifier(const std::string &identifier) {
   std::string quoted = "\"";
@@ -28,51 +39,191 @@ SchemaManager::SchemaManager(DatabaseManager &dbManager)
     : dbManager(dbManager) {}
 
 bool SchemaManager::ensureTableExists(
-    int /* deviceId */,
-    const std::vector<RegisterDefinition> & /* registers */) {
-  constexpr const char *TABLE_NAME = "modbus_data";
+    int deviceId, const std::vector<RegisterDefinition> &registers) {
+  if (!dbManager.isConnected()) {
+    return false;
+  }
+
+  try {
+    pqxx::work txn(dbManager.getConnection());
+
+    // Dictionary of register names; samples refer to it by a smallint id
+    std::ostringstream registersQuery;
+    registersQuery << "CREATE TABLE IF NOT EXISTS "
+                   << quoteIdentifier(REGISTERS_TABLE_NAME) << " (";
+    registersQuery << "register_id SMALLINT GENERATED BY DEFAULT AS IDENTITY "
+                      "PRIMARY KEY";
+    registersQuery << ", device_id INTEGER NOT NULL";
+    registersQuery << ", name TEXT NOT NULL";
+    registersQuery << ", unit TEXT";
+    registersQuery << ", scale DOUBLE PRECISION";
+    registersQuery << ", UNIQUE (device_id, name)";
+    registersQuery << ")";
+    txn.exec(registersQuery.str());
+
+    std::ostringstream samplesQuery;
+    samplesQuery << "CREATE TABLE IF NOT EXISTS "
+                 << quoteIdentifier(SAMPLES_TABLE_NAME) << " (";
+    samplesQuery << "register_id SMALLINT NOT NULL REFERENCES "
+                 << quoteIdentifier(REGISTERS_TABLE_NAME);
+    samplesQuery << ", " << quoteIdentifier(TIMESTAMP_COLUMN_NAME)
+                 << " TIMESTAMPTZ NOT NULL";
+    samplesQuery << ", value DOUBLE PRECISION";
+    samplesQuery << ")";
+    txn.exec(samplesQuery.str());
+
+    // Aggregates per register and UTC-aligned bucket start
+    for (RollupInterval interval : dbManager.getConfig().rollups) {
+      std::ostringstream rollupQuery;
+      rollupQuery << "CREATE TABLE IF NOT EXISTS "
+                  << quoteIdentifier(
+                         DatabaseManager::getRollupTableName(interval))
+                  << " (";
+      rollupQuery << "register_id SMALLINT NOT NULL REFERENCES "
+                  << quoteIdentifier(REGISTERS_TABLE_NAME);
+      rollupQuery << ", " << quoteIdentifier(TIMESTAMP_COLUMN_NAME)
+                  << " TIMESTAMPTZ NOT NULL";
+      rollupQuery << ", min DOUBLE PRECISION";
+      rollupQuery << ", max DOUBLE PRECISION";
+      rollupQuery << ", avg DOUBLE PRECISION";
+      rollupQuery << ", first DOUBLE PRECISION";
+      rollupQuery << ", last DOUBLE PRECISION";
+      rollupQuery << ", count INTEGER NOT NULL";
+      rollupQuery << ", PRIMARY KEY (register_id, "
+                  << quoteIdentifier(TIMESTAMP_COLUMN_NAME) << ")";
+      rollupQuery << ")";
+      txn.exec(rollupQuery.str());
+    }
 
-  if (dbManager.tableExists(TABLE_NAME)) {
-    // Table exists, ensure indexes are created
-    return ensureIndexesExist();
+    // Per-day, per-zone increases of counter registers
+    bool hasCounters = std::any_of(
+        registers.begin(), registers.end(),
+        [](const RegisterDefinition &reg) { return reg.counter; });
+    if (hasCounters) {
+      std::ostringstream tariffQuery;
+      tariffQuery << "CREATE TABLE IF NOT EXISTS "
+                  << quoteIdentifier(TARIFF_TOTALS_TABLE_NAME) << " (";
+      tariffQuery << "register_id SMALLINT NOT NULL REFERENCES "
+                  << quoteIdentifier(REGISTERS_TABLE_NAME);
+      tariffQuery << ", day DATE NOT NULL";
+      tariffQuery << ", zone TEXT NOT NULL";
+      tariffQuery << ", energy DOUBLE PRECISION NOT NULL";
+      tariffQuery << ", last_value DOUBLE PRECISION";
+      tariffQuery << ", last_time TIMESTAMPTZ";
+      tariffQuery << ", PRIMARY KEY (register_id, day, zone)";
+      tariffQuery << ")";
+      txn.exec(tariffQuery.str());
+      // Tables created before the reading time was kept
+      txn.exec("ALTER TABLE " + quoteIdentifier(TARIFF_TOTALS_TABLE_NAME) +
+               " ADD COLUMN IF NOT EXISTS last_time TIMESTAMPTZ");
+    }
+
+    std::string dataKind = getRelationKind(txn, DATA_VIEW_NAME);
+    if (dataKind == "r") {
+      // Table of the text-keyed layout. Continuous aggregates may depend on
+      // it, so it is left alone until sql/migrate_modbus_data.sql is run
+      std::cerr << "Warning: " << DATA_VIEW_NAME
+                << " is a table of the old layout and no longer receives "
+                   "values (they go to "
+                << SAMPLES_TABLE_NAME
+                << "); run sql/migrate_modbus_data.sql to migrate it"
+                << std::endl;
+    } else if (dataKind.empty()) {
+      // Legacy table of an earlier upgrade that renamed it at startup
+      bool hasLegacy = !getRelationKind(txn, LEGACY_TABLE_NAME).empty();
+      txn.exec(getDataViewQuery(hasLegacy));
+    }
+
+    syncRegisters(txn, deviceId, registers);
+    txn.commit();
+  } catch (const std::exception &e) {
+    std::cerr << "Error: Failed to ensure schema: " << e.what() << std::endl;
+    return false;
   }
 
-  // Create normalized table structure
-  pqxx::work txn(dbManager.getConnection());
-  std::ostringstream query;
-  query << "CREATE TABLE " << quoteIdentifier(TABLE_NAME) << " (";
-  query << "id SERIAL NOT NULL";
-  query << ", device_id INTEGER NOT NULL";
-  query << ", " << quoteIdentifier(TIMESTAMP_COLUMN_NAME)
-        << " TIMESTAMPTZ NOT NULL DEFAULT CURRENT_TIMESTAMP";
-  query << ", register_name TEXT NOT NULL";
-  query << ", value DOUBLE PRECISION";
-  query << ", PRIMARY KEY (id, " << quoteIdentifier(TIMESTAMP_COLUMN_NAME)
-        << ")";
-  query << ")";
-  std::string queryStr = query.str();
-  txn.exec(queryStr);
-  txn.commit();
-
-  // Create indexes
-  return ensureIndexesExist();
+  if (!ensureIndexesExist()) {
+    return false;
+  }
+
+  // Samples of one register compress well together
+  if (dbManager.getConfig().timescale.enabled &&
+      !ensureHypertable(SAMPLES_TABLE_NAME, "register_id")) {
+    return false;
+  }
+  if (dbManager.getConfig().timescale.enabled) {
+    for (RollupInterval interval : dbManager.getConfig().rollups) {
+      if (!ensureHypertable(DatabaseManager::getRollupTableName(interval),
+                            "register_id")) {
+        return false;
+      }
+    }
+  }
+
+  if (dbManager.getConfig().storageMode == StorageMode::Wide &&
+      !registers.empty()) {
+    return addMissingColumns(deviceId, registers);
+  }
+  return true;
 }
 
 bool SchemaManager::addMissingColumns(
-    int /* deviceId */,
-    const std::vector<RegisterDefinition> & /* registers */) {
-  // Not needed for normalized structure - all registers use same schema
-  // This method is kept for backward compatibility but does nothing
-  return ensureIndexesExist();
+    int deviceId, const std::vector<RegisterDefinition> &registers) {
+  // Wide mode only: the device table gets a typed column per register
+  std::string tableName = DatabaseManager::getWideTableName(deviceId);
+
+  try {
+    pqxx::work txn(dbManager.getConnection());
+    txn.exec("CREATE TABLE IF NOT EXISTS " + quoteIdentifier(tableName) +
+             " (" + quoteIdentifier(TIMESTAMP_COLUMN_NAME) +
+             " TIMESTAMPTZ NOT NULL)");
+    txn.exec("CREATE INDEX IF NOT EXISTS " +
+             quoteIdentifier("idx_" + tableName + "_timestamp") + " ON " +
+             quoteIdentifier(tableName) + "(timestamp)");
+    txn.commit();
+  } catch (const std::exception &e) {
+    std::cerr << "Error: Failed to create table " << tableName << ": "
+              << e.what() << std::endl;
+    return false;
+  }
+
+  // One device per table, so there is nothing to segment by
+  if (dbManager.getConfig().timescale.enabled &&
+      !ensureHypertable(tableName, "")) {
+    return false;
+  }
+
+  std::vector<std::string> existing = getExistingColumns(tableName);
+  for (const auto &reg : registers) {
+    if (std::find(existing.begin(), existing.end(), reg.name) ==
+        existing.end()) {
+      try {
+        pqxx::work txn(dbManager.getConnection());
+        txn.exec("ALTER TABLE " + quoteIdentifier(tableName) +
+                 " ADD COLUMN " + quoteIdentifier(reg.name) + " " +
+                 DOUBLE_PRECISION_TYPE);
+        txn.commit();
+      } catch (const std::exception &e) {
+        std::cerr << "Error: Failed to add column " << reg.name << ": "
+                  << e.what() << std::endl;
+        return false;
+      }
+    } else if (needsColumnAlter(getCurrentColumnType(tableName, reg.name),
+                                DOUBLE_PRECISION_TYPE)) {
+      // Columns created as INTEGER/DECIMAL by older versions
+      if (!alterColumnType(tableName, reg.name, DOUBLE_PRECISION_TYPE)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
 }
 
 std::string SchemaManager::getTableName(int /* deviceId */) const {
-  return "modbus_data";
+  return SAMPLES_TABLE_NAME;
 }
 
 bool SchemaManager::ensureIndexesExist() {
-  constexpr const char *TABLE_NAME = "modbus_data";
-
   if (!dbManager.isConnected()) {
     return false;
   }
@@ -80,18 +231,18 @@ bool SchemaManager::ensureIndexesExist() {
   try {
     pqxx::work txn(dbManager.getConnection());
 
-    // Index on timestamp and register_name
+    // Index on timestamp and register for time-window scans
     std::string idx1Query =
-        "CREATE INDEX IF NOT EXISTS idx_modbus_data_timestamp_register "
+        "CREATE INDEX IF NOT EXISTS idx_modbus_samples_timestamp_register "
         "ON " +
-        quoteIdentifier(TABLE_NAME) + "(timestamp, register_name)";
+        quoteIdentifier(SAMPLES_TABLE_NAME) + "(timestamp, register_id)";
     txn.exec(idx1Query);
 
-    // Index on register_name and timestamp DESC for register-specific queries
+    // Index on register and timestamp DESC for register-specific queries
     std::string idx2Query =
-        "CREATE INDEX IF NOT EXISTS idx_modbus_data_register_timestamp_desc "
+        "CREATE INDEX IF NOT EXISTS idx_modbus_samples_register_timestamp_desc "
         "ON " +
-        quoteIdentifier(TABLE_NAME) + "(register_name, timestamp DESC)";
+        quoteIdentifier(SAMPLES_TABLE_NAME) + "(register_id, timestamp DESC)";
     txn.exec(idx2Query);
 
     txn.commit();
@@ -102,54 +253,108 @@ bool SchemaManager::ensureIndexesExist() {
   }
 }
 
-std::string SchemaManager::getColumnType(const RegisterDefinition &reg) const {
-  switch (reg.type) {
-  case RegisterType::Float32:
-    return "FLOAT";
-
-  case RegisterType::Int16:
-  case RegisterType::Int32: {
-    // Check if scale is integer
-    bool isIntegerScale = (reg.scale == static_cast<int64_t>(reg.scale));
+bool SchemaManager::ensureHypertable(const std::string &tableName,
+                                     const std::string &segmentBy) {
+  const TimescaleConfig &timescale = dbManager.getConfig().timescale;
 
-    if (isIntegerScale) {
-      return "INTEGER";
-    } else {
-      if (reg.type == RegisterType::Int32) {
-        return "DECIMAL(10, 2)";
-      } else {
-        return "DECIMAL(6, 2)";
+  try {
+    pqxx::work txn(dbManager.getConnection());
+    txn.exec("CREATE EXTENSION IF NOT EXISTS timescaledb");
+
+    // Rows of an existing plain table are moved into chunks on the first run
+    txn.exec("SELECT create_hypertable(" + txn.quote(tableName) + ", " +
+             txn.quote(TIMESTAMP_COLUMN_NAME) + ", chunk_time_interval => " +
+             txn.quote(timescale.chunkInterval) +
+             "::interval, if_not_exists => TRUE, migrate_data => TRUE)");
+    // Applies to chunks created from now on
+    txn.exec("SELECT set_chunk_time_interval(" + txn.quote(tableName) + ", " +
+             txn.quote(timescale.chunkInterval) + "::interval)");
+
+    // Settings cannot change once chunks are compressed, so set them once
+    pqxx::result result =
+        txn.exec("SELECT compression_enabled "
+                 "FROM timescaledb_information.hypertables "
+                 "WHERE hypertable_schema = current_schema() "
+                 "AND hypertable_name = " +
+                 txn.quote(tableName));
+    if (!result.empty() && !result[0][0].as<bool>()) {
+      std::string settings = "timescaledb.compress, "
+                             "timescaledb.compress_orderby = " +
+                             txn.quote(quoteIdentifier(TIMESTAMP_COLUMN_NAME) +
+                                       " DESC");
+      if (!segmentBy.empty()) {
+        settings +=
+            ", timescaledb.compress_segmentby = " + txn.quote(segmentBy);
       }
+      txn.exec("ALTER TABLE " + quoteIdentifier(tableName) + " SET (" +
+               settings + ")");
     }
+
+    // Keeps an existing policy; change compress_after by removing it first
+    txn.exec("SELECT add_compression_policy(" + txn.quote(tableName) + ", " +
+             txn.quote(timescale.compressAfter) +
+             "::interval, if_not_exists => TRUE)");
+    txn.commit();
+    return true;
+  } catch (const std::exception &e) {
+    std::cerr << "Error: Failed to set up hypertable " << tableName << ": "
+              << e.what() << std::endl;
+    return false;
   }
+}
 
-  case RegisterType::Uint16:
-  case RegisterType::Uint32:
-  case RegisterType::Uint64: {
-    // Check if scale is integer
-    bool isIntegerScale = (reg.scale == static_cast<int64_t>(reg.scale));
-
-    if (isIntegerScale) {
-      if (reg.type == RegisterType::Uint64) {
-        return "BIGINT";
-      } else if (reg.type == RegisterType::Uint32) {
-        return "BIGINT";
-      } else {
-        return "INTEGER";
-      }
-    } else {
-      if (reg.type == RegisterType::Uint64) {
-        return "DECIMAL(20, 2)";
-      } else if (reg.type == RegisterType::Uint32) {
-        return "DECIMAL(10, 2)";
-      } else {
-        return "DECIMAL(6, 2)";
-      }
-    }
+std::string SchemaManager::getRelationKind(pqxx::work &txn,
+                                           const std::string &name) {
+  pqxx::result result =
+      txn.exec("SELECT relkind FROM pg_class WHERE oid = to_regclass(" +
+               txn.quote(quoteIdentifier(name)) + ")");
+  if (result.empty()) {
+    return "";
   }
+  return result[0][0].as<std::string>();
+}
+
+std::string SchemaManager::getDataViewQuery(bool withLegacy) {
+  // Same columns as the former modbus_data table (without its serial id), so
+  // queries in sql/ keep working
+  std::ostringstream query;
+  query << "CREATE OR REPLACE VIEW " << quoteIdentifier(DATA_VIEW_NAME)
+        << " AS ";
+  query << "SELECT r.device_id, s." << quoteIdentifier(TIMESTAMP_COLUMN_NAME)
+        << ", r.name AS register_name, s.value ";
+  query << "FROM " << quoteIdentifier(SAMPLES_TABLE_NAME) << " s ";
+  query << "JOIN " << quoteIdentifier(REGISTERS_TABLE_NAME)
+        << " r ON r.register_id = s.register_id";
+  if (withLegacy) {
+    query << " UNION ALL SELECT device_id, "
+          << quoteIdentifier(TIMESTAMP_COLUMN_NAME)
+          << ", register_name, value FROM "
+          << quoteIdentifier(LEGACY_TABLE_NAME);
+  }
+  return query.str();
+}
 
-  default:
-    return "FLOAT";
+void SchemaManager::syncRegisters(
+    pqxx::work &txn, int deviceId,
+    const std::vector<RegisterDefinition> &registers) {
+  for (const auto &reg : registers) {
+    std::string name = txn.quote(reg.name);
+    std::string unit = reg.unit.empty() ? "NULL" : txn.quote(reg.unit);
+    std::string scale = txn.quote(reg.scale);
+    std::string match = "device_id = " + std::to_string(deviceId) +
+                        " AND name = " + name;
+
+    // Insert only missing names: a conflicting insert would still consume a
+    // value of the smallint id sequence
+    txn.exec("INSERT INTO " + quoteIdentifier(REGISTERS_TABLE_NAME) +
+             " (device_id, name, unit, scale) SELECT " +
+             std::to_string(deviceId) + ", " + name + ", " + unit + ", " +
+             scale + " WHERE NOT EXISTS (SELECT FROM " +
+             quoteIdentifier(REGISTERS_TABLE_NAME) + " WHERE " + match + ")");
+    txn.exec("UPDATE " + quoteIdentifier(REGISTERS_TABLE_NAME) +
+             " SET unit = " + unit + ", scale = " + scale + " WHERE " + match +
+             " AND (unit IS DISTINCT FROM " + unit +
+             " OR scale IS DISTINCT FROM " + scale + ")");
   }
 }
 
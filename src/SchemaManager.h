@@ -8,17 +8,35 @@
 
 namespace ModbusLogger {
 
+// Owns the database layout: samples in modbus_samples keyed by a smallint
+// register_id, the registers dictionary that maps ids to device and name, and
+// the modbus_data view that joins them back into the original columns (once a
+// table of the old layout is migrated by sql/migrate_modbus_data.sql). In
+// wide storage mode each device also gets a modbus_<id> table with a typed
+// column per register, and each configured rollup interval a
+// modbus_rollup_<width> table. Devices with counter registers add
+// modbus_tariff_totals. With TimescaleDB enabled the sample and rollup tables
+// become compressed hypertables.
 class SchemaManager {
 public:
     explicit SchemaManager(DatabaseManager& dbManager);
 
+    // Create missing tables, view and indexes, and add the device's registers
+    // to the dictionary (updating unit and scale of known ones)
     bool ensureTableExists(int deviceId, const std::vector<RegisterDefinition>& registers);
+    // Wide storage mode: create the device table and add or retype the
+    // column of each register
     bool addMissingColumns(int deviceId, const std::vector<RegisterDefinition>& registers);
 
 private:
     std::string getTableName(int deviceId) const;
     bool ensureIndexesExist();
-    std::string getColumnType(const RegisterDefinition& reg) const;
+    // TimescaleDB mode: convert the table and set up compression
+    bool ensureHypertable(const std::string& tableName, const std::string& segmentBy);
+    // pg_class.relkind of a relation ("r" table, "v" view), "" if missing
+    std::string getRelationKind(pqxx::work& txn, const std::string& name);
+    std::string getDataViewQuery(bool withLegacy);
+    void syncRegisters(pqxx::work& txn, int deviceId, const std::vector<RegisterDefinition>& registers);
     std::vector<std::string> getExistingColumns(const std::string& tableName);
     bool columnExists(const std::string& tableName, const std::string& columnName);
     std::string getCurrentColumnType(const std::string& tableName, const std::string& columnName);
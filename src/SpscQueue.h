@@ -0,0 +1,68 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Bounded lock-free ring buffer for exactly one producer thread and one
+// consumer thread. Slots are allocated once; push/pop never allocate.
+template <typename T> class SpscQueue {
+public:
+  explicit SpscQueue(size_t capacity) : slots(capacity + 1), head(0), tail(0) {}
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Producer side. Returns false if the queue is full.
+  bool tryPush(T &&item) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    size_t nextTail = increment(currentTail);
+    if (nextTail == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots[currentTail] = std::move(item);
+    tail.store(nextTail, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if the queue is empty.
+  bool tryPop(T &item) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = std::move(slots[currentHead]);
+    head.store(increment(currentHead), std::memory_order_release);
+    return true;
+  }
+
+  // Approximate number of queued items (exact when called from either side
+  // while the other side is idle)
+  size_t size() const {
+    size_t currentHead = head.load(std::memory_order_acquire);
+    size_t currentTail = tail.load(std::memory_order_acquire);
+    return currentTail >= currentHead ? currentTail - currentHead
+                                      : slots.size() - currentHead + currentTail;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  size_t capacity() const { return slots.size() - 1; }
+
+private:
+  size_t increment(size_t index) const {
+    return index + 1 == slots.size() ? 0 : index + 1;
+  }
+
+  std::vector<T> slots;
+  alignas(64) std::atomic<size_t> head; // Next slot to pop (consumer)
+  alignas(64) std::atomic<size_t> tail; // Next slot to fill (producer)
+};
+
+} // namespace ModbusLogger
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,167 @@
+#include "StateSnapshot.h"
+#include "Crc32.h"
+#include "Types.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <unistd.h>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr uint32_t SNAPSHOT_MAGIC = 0x4D4C5354; // "MLST"
+constexpr uint16_t SNAPSHOT_VERSION = 1;
+constexpr size_t MAX_NAME_LENGTH = 63;
+
+struct SnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t count;
+  uint32_t crc; // Over the fields above
+};
+
+struct SnapshotRecord {
+  int64_t writeTimeMicros;
+  double value;
+  int32_t deviceId;
+  uint8_t nameLength;
+  char registerName[MAX_NAME_LENGTH];
+  uint32_t crc; // Over all fields above
+};
+
+static_assert(sizeof(SnapshotHeader) == 16,
+              "Unexpected snapshot header layout");
+static_assert(sizeof(SnapshotRecord) == 88,
+              "Unexpected snapshot record layout");
+
+uint32_t headerCrc(const SnapshotHeader &header) {
+  return crc32(&header, offsetof(SnapshotHeader, crc));
+}
+
+uint32_t recordCrc(const SnapshotRecord &record) {
+  return crc32(&record, offsetof(SnapshotRecord, crc));
+}
+} // namespace
+
+StateSnapshot::StateSnapshot(const std::string &path) : path(path) {}
+
+bool StateSnapshot::save(const std::vector<Entry> &entries) {
+  std::vector<SnapshotRecord> records;
+  records.reserve(entries.size());
+  for (const Entry &entry : entries) {
+    if (entry.registerName.size() > MAX_NAME_LENGTH) {
+      continue;
+    }
+    SnapshotRecord record{};
+    record.writeTimeMicros = toEpochMicros(entry.writeTime);
+    record.value = entry.value;
+    record.deviceId = entry.deviceId;
+    record.nameLength = static_cast<uint8_t>(entry.registerName.size());
+    std::memcpy(record.registerName, entry.registerName.data(),
+                entry.registerName.size());
+    record.crc = recordCrc(record);
+    records.push_back(record);
+  }
+
+  SnapshotHeader header{};
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  header.recordSize = sizeof(SnapshotRecord);
+  header.count = static_cast<uint32_t>(records.size());
+  header.crc = headerCrc(header);
+
+  try {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+      std::filesystem::create_directories(parent);
+    }
+  } catch (const std::filesystem::filesystem_error &e) {
+    lastError = "Cannot create snapshot directory: " + std::string(e.what());
+    return false;
+  }
+
+  // Write a temporary file and rename it over the old snapshot, so a crash
+  // mid-save leaves the previous one intact
+  std::string tempPath = path + ".tmp";
+  FILE *file = std::fopen(tempPath.c_str(), "wb");
+  if (file == nullptr) {
+    lastError = "Cannot create " + tempPath + ": " + std::strerror(errno);
+    return false;
+  }
+
+  bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  if (written && !records.empty()) {
+    written = std::fwrite(records.data(), sizeof(SnapshotRecord),
+                          records.size(), file) == records.size();
+  }
+  written = written && std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+  written = std::fclose(file) == 0 && written;
+  if (!written) {
+    lastError = "Cannot write " + tempPath + ": " + std::strerror(errno);
+    std::remove(tempPath.c_str());
+    return false;
+  }
+
+  if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    lastError = "Cannot replace " + path + ": " + std::strerror(errno);
+    std::remove(tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool StateSnapshot::load(std::vector<Entry> &entries) {
+  entries.clear();
+
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    if (errno == ENOENT) {
+      return true;
+    }
+    lastError = "Cannot open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+
+  SnapshotHeader header{};
+  if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+      header.magic != SNAPSHOT_MAGIC || header.crc != headerCrc(header) ||
+      header.version != SNAPSHOT_VERSION ||
+      header.recordSize != sizeof(SnapshotRecord)) {
+    std::fclose(file);
+    lastError = "Invalid snapshot header in " + path;
+    return false;
+  }
+
+  size_t corrupt = 0;
+  for (uint32_t i = 0; i < header.count; ++i) {
+    SnapshotRecord record{};
+    if (std::fread(&record, sizeof(record), 1, file) != 1) {
+      corrupt += header.count - i;
+      break;
+    }
+    if (record.crc != recordCrc(record) ||
+        record.nameLength > MAX_NAME_LENGTH) {
+      ++corrupt;
+      continue;
+    }
+    entries.push_back({record.deviceId,
+                       std::string(record.registerName, record.nameLength),
+                       record.value, fromEpochMicros(record.writeTimeMicros)});
+  }
+  std::fclose(file);
+
+  if (corrupt > 0) {
+    std::cerr << "Warning: Skipping " << corrupt
+              << " corrupt records in snapshot " << path << std::endl;
+  }
+  return true;
+}
+
+std::string StateSnapshot::getLastError() const { return lastError; }
+
+} // namespace ModbusLogger
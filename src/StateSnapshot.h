@@ -0,0 +1,39 @@
+#ifndef STATESNAPSHOT_H
+#define STATESNAPSHOT_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Change-detection state kept across restarts: the last stored value of each
+// register and when it was written. A small file of CRC-checked records that
+// is replaced atomically on every save, so the daemon can warm-start without
+// scanning the sample history.
+class StateSnapshot {
+public:
+  struct Entry {
+    int deviceId;
+    std::string registerName;
+    double value;
+    std::chrono::system_clock::time_point writeTime;
+  };
+
+  explicit StateSnapshot(const std::string &path);
+
+  bool save(const std::vector<Entry> &entries);
+
+  // Read all valid entries; a missing file is not an error
+  bool load(std::vector<Entry> &entries);
+
+  std::string getLastError() const;
+
+private:
+  std::string path;
+  std::string lastError;
+};
+
+} // namespace ModbusLogger
+
+#endif // STATESNAPSHOT_H
@@ -0,0 +1,62 @@
+#include "SwingingDoor.h"
+#include <algorithm>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr double MICROS_PER_SECOND = 1000000.0;
+} // namespace
+
+SwingingDoor::SwingingDoor()
+    : archived{0, 0.0}, held{0, 0.0}, started(false), hasHeld(false),
+      upperSlope(0.0), lowerSlope(0.0) {}
+
+void SwingingDoor::reset(const Point &point) {
+  archived = point;
+  started = true;
+  hasHeld = false;
+}
+
+bool SwingingDoor::isStarted() const { return started; }
+
+bool SwingingDoor::offer(const Point &point, double deviation, Point &stored) {
+  double elapsed = (point.timeMicros - archived.timeMicros) / MICROS_PER_SECOND;
+  if (elapsed <= 0.0) {
+    return false;
+  }
+
+  // The line from the stored point straight to this one must pass within
+  // the deviation of every point seen in between
+  double slope = (point.value - archived.value) / elapsed;
+  if (!hasHeld || (slope >= upperSlope && slope <= lowerSlope)) {
+    double upper = (point.value - archived.value - deviation) / elapsed;
+    double lower = (point.value - archived.value + deviation) / elapsed;
+    upperSlope = hasHeld ? std::max(upperSlope, upper) : upper;
+    lowerSlope = hasHeld ? std::min(lowerSlope, lower) : lower;
+    held = point;
+    hasHeld = true;
+    return false;
+  }
+
+  // Doors closed on this point: the held point ends the segment and starts
+  // the next
+  stored = held;
+  archived = held;
+  elapsed = (point.timeMicros - archived.timeMicros) / MICROS_PER_SECOND;
+  upperSlope = (point.value - archived.value - deviation) / elapsed;
+  lowerSlope = (point.value - archived.value + deviation) / elapsed;
+  held = point;
+  return true;
+}
+
+bool SwingingDoor::takeHeld(Point &stored) {
+  if (!hasHeld) {
+    return false;
+  }
+  stored = held;
+  archived = held;
+  hasHeld = false;
+  return true;
+}
+
+} // namespace ModbusLogger
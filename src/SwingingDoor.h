@@ -0,0 +1,45 @@
+#ifndef SWINGINGDOOR_H
+#define SWINGINGDOOR_H
+
+#include <cstdint>
+
+namespace ModbusLogger {
+
+// Swinging-door trending for one register. Starting from the last stored
+// point it keeps the corridor of lines that pass within +-deviation of every
+// point seen since; once the line to a new point leaves the corridor, the
+// point before it must be stored. Interpolating linearly between stored
+// points then rebuilds every dropped point within the deviation.
+class SwingingDoor {
+public:
+  struct Point {
+    int64_t timeMicros;
+    double value;
+  };
+
+  SwingingDoor();
+
+  // Start a new segment at a stored point
+  void reset(const Point &point);
+  bool isStarted() const;
+
+  // Offer the next point. Returns true if stored must be written; the
+  // segment then continues from it.
+  bool offer(const Point &point, double deviation, Point &stored);
+
+  // End the segment with the point held since the last stored one, when no
+  // point follows (e.g. at shutdown). Returns false if there is none.
+  bool takeHeld(Point &stored);
+
+private:
+  Point archived;   // Last stored point
+  Point held;       // Last point seen, stored when the corridor closes
+  bool started;
+  bool hasHeld;
+  double upperSlope; // Per second, steepest line through archived + deviation
+  double lowerSlope; // Per second, flattest line through archived - deviation
+};
+
+} // namespace ModbusLogger
+
+#endif // SWINGINGDOOR_H
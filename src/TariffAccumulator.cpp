@@ -0,0 +1,192 @@
+#include "TariffAccumulator.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iterator>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr int MINUTES_PER_DAY = 24 * 60;
+constexpr int64_t MICROS_PER_SECOND = 1000000;
+
+// Counter value a raw unsigned register wraps at; 0 if unknown, e.g. when an
+// expression transforms it
+double getWrap(const RegisterDefinition &reg) {
+  if (!reg.expression.empty()) {
+    return 0.0;
+  }
+  switch (reg.type) {
+  case RegisterType::Uint16:
+    return std::ldexp(1.0, 16) * reg.scale;
+  case RegisterType::Uint32:
+    return std::ldexp(1.0, 32) * reg.scale;
+  case RegisterType::Uint64:
+    return std::ldexp(1.0, 64) * reg.scale;
+  default:
+    return 0.0;
+  }
+}
+} // namespace
+
+TariffAccumulator::TariffAccumulator(
+    int deviceId, const std::vector<RegisterDefinition> &registers,
+    const TariffConfig &tariff)
+    : deviceId(deviceId), tariff(tariff), periodStartMicros(0),
+      periodEndMicros(0) {
+  names.reserve(registers.size());
+  counters.reserve(registers.size());
+  for (const auto &reg : registers) {
+    names.push_back(reg.name);
+    bool enabled = reg.counter && reg.enabled;
+    counters.push_back(
+        {enabled, getWrap(reg), false, 0.0, false, 0.0, false, 0.0, {}});
+    if (enabled) {
+      counterIds.push_back(reg.id);
+    }
+  }
+}
+
+bool TariffAccumulator::hasCounters() const { return !counterIds.empty(); }
+
+void TariffAccumulator::setPrevious(uint16_t registerId, double value) {
+  Counter &counter = counters[registerId];
+  if (counter.enabled && std::isfinite(value)) {
+    counter.previous = value;
+    counter.hasPrevious = true;
+    counter.hasCandidate = false;
+  }
+}
+
+void TariffAccumulator::add(uint16_t registerId, double value,
+                            std::chrono::system_clock::time_point timestamp) {
+  Counter &counter = counters[registerId];
+  if (!counter.enabled || !std::isfinite(value)) {
+    return;
+  }
+  if (!counter.hasPrevious) {
+    counter.previous = value;
+    counter.hasPrevious = true;
+    return;
+  }
+
+  double delta;
+  if (counter.hasCandidate && value < counter.previous) {
+    if (value < counter.candidate) {
+      counter.candidate = value; // Lower still; wait for the next reading
+      return;
+    }
+    // Confirmed: counting restarted from zero and went on from the candidate
+    delta = std::max(value, 0.0);
+  } else {
+    // With a candidate, back at the old reading or above: the low reading
+    // was a glitch and the increase counts from the old one
+    delta = value - counter.previous;
+    if (delta < 0.0) {
+      if (counter.wrap > 0.0 && -delta > counter.wrap / 2) {
+        delta += counter.wrap; // Passed the top of the register range
+      } else {
+        // A reset or a bad reading (e.g. 0 while the device boots); the next
+        // reading tells
+        counter.candidate = value;
+        counter.hasCandidate = true;
+        return;
+      }
+    }
+  }
+  counter.hasCandidate = false;
+
+  updatePeriod(toEpochMicros(timestamp));
+  counter.previous = value;
+  counter.previousTime = timestamp;
+  counter.total = counter.pending ? counter.total + delta : delta;
+  counter.pending = true;
+}
+
+void TariffAccumulator::collect(std::vector<TariffRow> &rows) {
+  std::move(closed.begin(), closed.end(), std::back_inserter(rows));
+  closed.clear();
+  for (uint16_t id : counterIds) {
+    if (counters[id].pending) {
+      close(id, rows);
+    }
+  }
+}
+
+const std::string &TariffAccumulator::getZone(const TariffConfig &tariff,
+                                              int minuteOfDay) {
+  for (const auto &zone : tariff.zones) {
+    bool inside = zone.fromMinute < zone.toMinute
+                      ? minuteOfDay >= zone.fromMinute &&
+                            minuteOfDay < zone.toMinute
+                      : minuteOfDay >= zone.fromMinute ||
+                            minuteOfDay < zone.toMinute;
+    if (inside) {
+      return zone.name;
+    }
+  }
+  return tariff.defaultZone;
+}
+
+void TariffAccumulator::updatePeriod(int64_t micros) {
+  if (micros >= periodStartMicros && micros < periodEndMicros) {
+    return;
+  }
+
+  std::time_t seconds = static_cast<std::time_t>(micros / MICROS_PER_SECOND);
+  std::tm local{};
+  localtime_r(&seconds, &local);
+  int minute = local.tm_hour * 60 + local.tm_min;
+
+  // The zone can change next at a zone boundary or at midnight
+  int nextMinute = MINUTES_PER_DAY;
+  for (const auto &tariffZone : tariff.zones) {
+    for (int boundary : {tariffZone.fromMinute, tariffZone.toMinute}) {
+      if (boundary > minute) {
+        nextMinute = std::min(nextMinute, boundary);
+      }
+    }
+  }
+  std::tm next = local;
+  next.tm_hour = nextMinute / 60; // 24 is normalized to the next day
+  next.tm_min = nextMinute % 60;
+  next.tm_sec = 0;
+  next.tm_isdst = -1;
+  std::time_t end = std::mktime(&next);
+  if (end <= seconds) {
+    end = seconds + 60; // DST transition; look again a minute later
+  }
+
+  char dayText[11];
+  std::strftime(dayText, sizeof(dayText), "%Y-%m-%d", &local);
+  const std::string &zoneName = getZone(tariff, minute);
+  if (dayText != day || zoneName != zone) {
+    for (uint16_t id : counterIds) {
+      if (counters[id].pending) {
+        close(id, closed);
+      }
+    }
+    day = dayText;
+    zone = zoneName;
+  }
+
+  periodStartMicros = micros;
+  periodEndMicros = static_cast<int64_t>(end) * MICROS_PER_SECOND;
+}
+
+void TariffAccumulator::close(uint16_t registerId,
+                              std::vector<TariffRow> &rows) {
+  Counter &counter = counters[registerId];
+  TariffRow row;
+  row.deviceId = deviceId;
+  row.registerName = names[registerId];
+  row.day = day;
+  row.zone = zone;
+  row.delta = counter.total;
+  row.lastValue = counter.previous;
+  row.lastTime = counter.previousTime;
+  rows.push_back(std::move(row));
+  counter.pending = false;
+}
+
+} // namespace ModbusLogger
@@ -0,0 +1,77 @@
+#ifndef TARIFFACCUMULATOR_H
+#define TARIFFACCUMULATOR_H
+
+#include "Types.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Turns the readings of one device's counter registers (e.g. energy totals)
+// into increases, booked per local day and tariff zone. A decrease is a
+// wrap-around when the counter was near the top of its unsigned register
+// range. Any other decrease books nothing until the next reading: staying
+// at or above the low reading but below the old one confirms a reset
+// (counting restarted from zero), so daily counters such as gridBuyToday
+// work as well as lifetime ones; coming back to the old reading marks the
+// low one as a glitch.
+class TariffAccumulator {
+public:
+  // registers is the device's full register list, indexed by register id
+  TariffAccumulator(int deviceId,
+                    const std::vector<RegisterDefinition> &registers,
+                    const TariffConfig &tariff);
+
+  bool hasCounters() const;
+
+  // Reading the next increase is measured from, e.g. the last stored value
+  // of the previous run
+  void setPrevious(uint16_t registerId, double value);
+
+  // Ignored for registers that are not counters
+  void add(uint16_t registerId, double value,
+           std::chrono::system_clock::time_point timestamp);
+
+  // Append the increases accumulated since the last call
+  void collect(std::vector<TariffRow> &rows);
+
+  // Zone of a local time of day, in minutes after midnight
+  static const std::string &getZone(const TariffConfig &tariff,
+                                    int minuteOfDay);
+
+private:
+  struct Counter {
+    bool enabled;
+    double wrap; // Value at which it wraps to 0; 0 = never wraps
+    bool hasPrevious;
+    double previous;
+    bool pending; // total holds increases of the current day and zone
+    double total;
+    bool hasCandidate; // candidate is a possible reset, not yet confirmed
+    double candidate;
+    std::chrono::system_clock::time_point previousTime;
+  };
+
+  // Set the local day and zone of a time, closing the totals of the
+  // previous ones; cached while they cannot change
+  void updatePeriod(int64_t micros);
+  void close(uint16_t registerId, std::vector<TariffRow> &rows);
+
+  int deviceId;
+  TariffConfig tariff;
+  std::vector<std::string> names; // By register id
+  std::vector<Counter> counters;  // By register id
+  std::vector<uint16_t> counterIds;
+
+  std::string day; // YYYY-MM-DD
+  std::string zone;
+  int64_t periodStartMicros;
+  int64_t periodEndMicros;
+  std::vector<TariffRow> closed; // Closed by add() before the next collect
+};
+
+} // namespace ModbusLogger
+
+#endif // TARIFFACCUMULATOR_H
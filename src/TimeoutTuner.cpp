@@ -0,0 +1,94 @@
+#include "TimeoutTuner.h"
+#include <algorithm>
+#include <iostream>
+
+namespace ModbusLogger {
+
+namespace {
+constexpr size_t SAMPLE_WINDOW = 256;
+constexpr size_t MIN_SAMPLES = 32;     // Before the first tuning
+constexpr size_t RETUNE_INTERVAL = 32; // Responses between tunings
+constexpr double PERCENTILE = 0.99;
+constexpr double MARGIN_FACTOR = 1.5;
+constexpr auto MARGIN = std::chrono::microseconds(20000);
+constexpr auto MIN_TIMEOUT = std::chrono::microseconds(50000);
+} // namespace
+
+TimeoutTuner::TimeoutTuner(const ConnectionParams &connection, int deviceId)
+    : deviceId(deviceId), autoTune(connection.autoTuneTimeout),
+      maxTimeout(std::chrono::milliseconds(connection.responseTimeoutMs)),
+      responseTimeout(maxTimeout),
+      byteTimeout(std::chrono::milliseconds(connection.byteTimeoutMs)),
+      nextSample(0), samplesSinceTune(0), respondedSinceTimeout(true) {
+  if (autoTune) {
+    samples.reserve(SAMPLE_WINDOW);
+  }
+}
+
+std::chrono::microseconds TimeoutTuner::getResponseTimeout() const {
+  return responseTimeout;
+}
+
+std::chrono::microseconds TimeoutTuner::getByteTimeout() const {
+  return byteTimeout;
+}
+
+void TimeoutTuner::recordResponse(std::chrono::microseconds responseTime) {
+  if (!autoTune) {
+    return;
+  }
+
+  respondedSinceTimeout = true;
+  if (samples.size() < SAMPLE_WINDOW) {
+    samples.push_back(responseTime.count());
+  } else {
+    samples[nextSample] = responseTime.count();
+  }
+  nextSample = (nextSample + 1) % SAMPLE_WINDOW;
+
+  if (++samplesSinceTune >= RETUNE_INTERVAL && samples.size() >= MIN_SAMPLES) {
+    retune();
+  }
+}
+
+void TimeoutTuner::recordTimeout() {
+  if (!autoTune || !respondedSinceTimeout) {
+    // Repeated timeouts mean the device is gone; keep failing fast
+    return;
+  }
+
+  // First timeout of a live device: the tuned value may be too tight
+  respondedSinceTimeout = false;
+  auto widened = std::min(maxTimeout, responseTimeout * 3 / 2);
+  if (widened != responseTimeout) {
+    responseTimeout = widened;
+    std::cerr << "Device " << deviceId << ": response timeout widened to "
+              << responseTimeout.count() / 1000.0 << " ms" << std::endl;
+  }
+}
+
+void TimeoutTuner::retune() {
+  samplesSinceTune = 0;
+
+  std::vector<int64_t> sorted(samples);
+  size_t index = static_cast<size_t>(PERCENTILE * (sorted.size() - 1));
+  std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+  std::chrono::microseconds percentile(sorted[index]);
+
+  auto tuned = std::chrono::duration_cast<std::chrono::microseconds>(
+                   percentile * MARGIN_FACTOR) +
+               MARGIN;
+  tuned = std::max(MIN_TIMEOUT, std::min(maxTimeout, tuned));
+
+  // Log only noticeable changes
+  auto change = tuned > responseTimeout ? tuned - responseTimeout
+                                        : responseTimeout - tuned;
+  if (change * 10 >= responseTimeout) {
+    std::cerr << "Device " << deviceId << ": response timeout tuned to "
+              << tuned.count() / 1000.0 << " ms (p99 response "
+              << percentile.count() / 1000.0 << " ms)" << std::endl;
+  }
+  responseTimeout = tuned;
+}
+
+} // namespace ModbusLogger
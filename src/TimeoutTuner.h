@@ -0,0 +1,42 @@
+#ifndef TIMEOUTTUNER_H
+#define TIMEOUTTUNER_H
+
+#include "Types.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ModbusLogger {
+
+// Response timeout of one device. Fixed at the configured value unless
+// auto-tuning is enabled; then it follows a high percentile of the recent
+// response times plus a margin, capped by the configured value, so a dead
+// device fails fast while a healthy one keeps headroom.
+class TimeoutTuner {
+public:
+  TimeoutTuner(const ConnectionParams &connection, int deviceId);
+
+  std::chrono::microseconds getResponseTimeout() const;
+  std::chrono::microseconds getByteTimeout() const;
+
+  void recordResponse(std::chrono::microseconds responseTime);
+  void recordTimeout();
+
+private:
+  void retune();
+
+  int deviceId;
+  bool autoTune;
+  std::chrono::microseconds maxTimeout;
+  std::chrono::microseconds responseTimeout;
+  std::chrono::microseconds byteTimeout;
+  std::vector<int64_t> samples; // Ring buffer of response times (us)
+  size_t nextSample;
+  size_t samplesSinceTune;
+  bool respondedSinceTimeout;
+};
+
+} // namespace ModbusLogger
+
+#endif // TIMEOUTTUNER_H
@@ -1,6 +1,7 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <chrono>
 #include <cstdint>
 #include <map>
 #include <string>
@@ -12,14 +13,54 @@ enum class RegisterType { Int16, Int32, Float32, Uint16, Uint32, Uint64 };
 
 enum class ModbusRegisterType { Coil, Discrete, Input, Holding };
 
+// Layout of 32/64-bit values across registers, with A the most significant
+// byte: word order first, then byte order within each word
+enum class WordOrder {
+  ABCD, // High word first (big-endian)
+  CDAB, // Low word first
+  BADC, // High word first, bytes swapped
+  DCBA  // Low word first, bytes swapped (little-endian)
+};
+
+// How change detection decides that a value is worth storing
+enum class CompressionMethod {
+  None,        // Any change
+  Deadband,    // Change beyond the tolerance from the last stored value
+  SwingingDoor // Points needed to interpolate within the tolerance
+};
+
+struct CompressionConfig {
+  CompressionMethod method = CompressionMethod::None;
+  double absolute = 0.0; // Tolerance in register units
+  double percent = 0.0;  // Tolerance in percent of the last stored value
+};
+
 struct RegisterDefinition {
+  uint16_t id; // Dense index within the device's registers, set at load
   uint16_t address;
   std::string name;
   RegisterType type;
   ModbusRegisterType regType;
   double scale;
-  bool preprocessing;
+  bool preprocessing; // Has an expression
   bool enabled;       // Include register in reading cycle
+  // Computed from other registers by its expression instead of read; x is
+  // its previous value
+  bool isVirtual = false;
+  std::string period; // Read period; empty = period of the enclosing range
+  std::string unit;   // Informational, stored in the registers dictionary
+  CompressionConfig compression;
+  // Formula applied to the scaled value (see Expression) and its lookup table
+  std::string expression;
+  std::map<int64_t, double> lookup;
+  // Of 32/64-bit types; the device's unless set on the register
+  WordOrder wordOrder = WordOrder::CDAB;
+  // Longest time an unchanged value goes unwritten: a period, "none" to never
+  // rewrite it, or empty for 180 read periods
+  std::string maxSilence;
+  // Monotonic counter (e.g. energy): its increases are totalled per day and
+  // tariff zone in modbus_tariff_totals
+  bool counter = false;
 };
 
 struct RangeDefinition {
@@ -35,6 +76,9 @@ struct ConnectionParams {
   char parity;
   int dataBits;
   int stopBits;
+  int responseTimeoutMs = 2000; // Upper bound when auto-tuned
+  int byteTimeoutMs = 100;
+  bool autoTuneTimeout = false; // Follow the observed response times
 };
 
 struct DeviceConfig {
@@ -42,18 +86,74 @@ struct DeviceConfig {
   ConnectionParams connection;
   bool isZero;
   bool enabled; // Include device in reading cycle
+  WordOrder wordOrder = WordOrder::CDAB; // Default for its registers
   std::vector<RegisterDefinition> registers;
   std::vector<RangeDefinition> ranges;
+  uint16_t maxReadWords = 125; // Registers per request (devices may allow fewer)
+  int maxReadGap = -1;         // Unused words a request may span; -1 = auto
+};
+
+// What the poll loop does when the writer queue is full
+enum class OverflowPolicy {
+  DropNewest, // Discard the sample being queued (poll timing never affected)
+  Block       // Wait for the writer to make room
+};
+
+// Layout of stored samples
+enum class StorageMode {
+  Narrow, // One row per value in modbus_samples
+  Wide    // One row per range read in modbus_<device id>, a column per register
+};
+
+struct WriterConfig {
+  size_t queueCapacity = 4096; // Samples buffered between poll and writer
+  OverflowPolicy overflowPolicy = OverflowPolicy::DropNewest;
+  // Samples are kept here while the database is unreachable ("" disables)
+  std::string spoolDirectory = "/var/lib/modbuslogger/spool";
+};
+
+// Optional TimescaleDB setup of the sample tables
+struct TimescaleConfig {
+  bool enabled = false;
+  std::string chunkInterval = "7 days"; // Time range of one chunk
+  std::string compressAfter = "7 days"; // Age at which chunks are compressed
+};
+
+// Bucket width of the aggregates kept in modbus_rollup_<width> tables
+enum class RollupInterval { Minute, Hour, Day };
+
+struct DatabaseConfig {
+  std::string connectionString;
+  StorageMode storageMode = StorageMode::Narrow;
+  TimescaleConfig timescale;
+  std::vector<RollupInterval> rollups; // Empty disables rollups
+};
+
+// Time-of-day band of an electricity tariff, in local time
+struct TariffZone {
+  std::string name;
+  int fromMinute; // Minutes after midnight
+  int toMinute;   // Exclusive; not after fromMinute = crosses midnight
+};
+
+// Schedule that increases of counter registers are booked against
+struct TariffConfig {
+  std::vector<TariffZone> zones;   // First match wins
+  std::string defaultZone = "day"; // Times no zone covers
 };
 
 struct Config {
-  std::string databaseConnectionString;
+  DatabaseConfig database;
+  TariffConfig tariff;
+  WriterConfig writer;
+  // Change-detection state saved across restarts ("" disables)
+  std::string stateFile = "/var/lib/modbuslogger/state.snapshot";
   std::vector<DeviceConfig> devices;
 };
 
 struct RegisterValue {
   uint16_t address;
-  std::string name;
+  uint16_t registerId;
   RegisterType type;
   ModbusRegisterType regType;
   double scale;
@@ -62,7 +162,52 @@ struct RegisterValue {
   double processedValue;
 };
 
-using RegisterValueMap = std::map<uint16_t, RegisterValue>;
+// One row destined for modbus_data
+struct SampleRow {
+  int deviceId;
+  std::chrono::system_clock::time_point timestamp;
+  std::string registerName;
+  double value;
+  uint16_t registerId = 0; // Index into the device's registers (in process)
+};
+
+// Aggregate of one register's reads over one time bucket
+struct RollupRow {
+  RollupInterval interval;
+  int deviceId;
+  std::string registerName;
+  std::chrono::system_clock::time_point bucket; // Start of the bucket
+  double min;
+  double max;
+  double avg;
+  double first;
+  double last;
+  uint32_t count;
+};
+
+// Increase of one counter register within a local day and tariff zone
+struct TariffRow {
+  int deviceId;
+  std::string registerName;
+  std::string day; // Local date, YYYY-MM-DD
+  std::string zone;
+  double delta;
+  double lastValue; // Counter reading at the end of the increase
+  std::chrono::system_clock::time_point lastTime; // Time of that reading
+};
+
+// Microseconds since the Unix epoch (PostgreSQL timestamptz resolution)
+inline int64_t toEpochMicros(std::chrono::system_clock::time_point timestamp) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             timestamp.time_since_epoch())
+      .count();
+}
+
+inline std::chrono::system_clock::time_point fromEpochMicros(int64_t micros) {
+  return std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::microseconds(micros)));
+}
 
 } // namespace ModbusLogger
 